@@ -5,7 +5,7 @@
 //debug
 #include <iostream>
 
-CameraCaptureThread::CameraCaptureThread() :IThread(), m_status(CAMERA_CAPTURE_STOPPED), m_camera(0), m_newcamera(-1)
+CameraCaptureThread::CameraCaptureThread() :IThread(), m_wantframe(nullptr), m_framepool(nullptr), m_raw(false), m_decimation(0), m_status(CAMERA_CAPTURE_STOPPED), m_camera(0), m_newcamera(-1), m_sequence(0), m_grabbed(0), m_firstframe(false), m_decoded(0), m_hasdriveroffset(false), m_driveroffset(0), m_lastdrivermsec(0)
 {
 
 }
@@ -21,11 +21,14 @@ void CameraCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
 	{
 		const CameraCaptureThreadParameters params = *(dynamic_cast<const CameraCaptureThreadParameters*>(threadparameters));
 		m_sendframe = params.m_sendframe;
+		m_wantframe = params.m_wantframe;
+		m_framepool = params.m_framepool;
+		m_format = params.m_format;
+		m_decimation = params.m_decimation;
 		m_camera = params.m_camera;
 
 		cv::VideoCapture vc;
 
-		cv::Mat im;
 		bool dosleep = false;
 
 		while (!m_stop)
@@ -37,9 +40,10 @@ void CameraCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
 				const int32_t nc = m_newcamera.load();
 				if (nc >= 0 && nc != m_camera)
 				{
-					if (vc.open(nc))
+					if (OpenCamera(vc, nc, m_format, m_raw))
 					{
 						m_camera = nc;
+						ResetCaptureClock();
 					}
 					else
 					{
@@ -50,17 +54,44 @@ void CameraCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
 
 				if (!vc.isOpened() && m_camera >= 0)
 				{
-					if (!vc.open(m_camera))
+					if (!OpenCamera(vc, m_camera, m_format, m_raw))
 					{
 						m_status = CAMERA_CAPTURE_ERROR;
 					}
+					ResetCaptureClock();
 				}
 
-				if (vc.read(im) && !im.empty())
+				// every frame is grabbed to keep the driver queue drained, but only the ones the detector will use are decoded
+				if (vc.grab())
 				{
-					if (m_sendframe)
+					const std::chrono::steady_clock::time_point grabtime = std::chrono::steady_clock::now();
+					const uint64_t sequence = ++m_sequence;
+					m_grabbed++;
+
+					// decode straight into a recycled buffer
+					const int32_t slot = (m_framepool && WantFrame(sequence)) ? m_framepool->Acquire() : -1;
+					if (slot >= 0 && Retrieve(vc, m_framepool->Frame(slot)))
+					{
+						m_decoded++;
+						if (m_firstframe)
+						{
+							std::cout << "First camera frame " << std::chrono::duration_cast<std::chrono::milliseconds>(grabtime - m_opentime).count() << " ms after opening the camera" << std::endl;
+							m_firstframe = false;
+						}
+						m_framepool->Sequence(slot) = sequence;
+						m_framepool->Timestamp(slot) = CaptureTimestamp(vc, grabtime);
+						if (m_sendframe)
+						{
+							m_sendframe(slot);
+						}
+						else
+						{
+							m_framepool->Release(slot);
+						}
+					}
+					else if (slot >= 0)
 					{
-						m_sendframe(im);
+						m_framepool->Release(slot);
 					}
 				}
 				else
@@ -79,6 +110,7 @@ void CameraCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
 			}
 		}
 
+		std::cout << "Camera decoded " << m_decoded << " of " << m_grabbed << " grabbed frames" << std::endl;
 		std::cout << "CameraCaptureThread::Run Thread Complete" << std::endl;
 	}
 	catch (std::exception& e)
@@ -88,6 +120,59 @@ void CameraCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
 
 }
 
+bool CameraCaptureThread::Retrieve(cv::VideoCapture& vc, cv::Mat& frame)
+{
+	if (m_raw)
+	{
+		return vc.retrieve(m_rawframe) && CopyRawYUYV(m_rawframe, static_cast<int32_t>(vc.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int32_t>(vc.get(cv::CAP_PROP_FRAME_HEIGHT)), frame);
+	}
+	return vc.retrieve(frame) && !frame.empty();
+}
+
+bool CameraCaptureThread::WantFrame(const uint64_t sequence) const
+{
+	if (m_decimation > 0)
+	{
+		return (sequence % m_decimation) == 0;
+	}
+	return !m_wantframe || m_wantframe();
+}
+
+std::chrono::steady_clock::time_point CameraCaptureThread::CaptureTimestamp(cv::VideoCapture& vc, const std::chrono::steady_clock::time_point grabtime)
+{
+	// backends without frame timestamps report 0, some report the same time for every frame
+	const double drivermsec = vc.get(cv::CAP_PROP_POS_MSEC);
+	if (drivermsec <= 0 || drivermsec <= m_lastdrivermsec)
+	{
+		m_lastdrivermsec = drivermsec;
+		return grabtime;
+	}
+	m_lastdrivermsec = drivermsec;
+
+	// the frame can't have been captured after it was grabbed, so the smallest offset seen is the closest to the real one
+	const double offset = std::chrono::duration<double, std::milli>(grabtime.time_since_epoch()).count() - drivermsec;
+	if (!m_hasdriveroffset || offset < m_driveroffset || offset > m_driveroffset + 1000.0)
+	{
+		m_driveroffset = offset;		// first frame, a smaller delay, or the driver clock jumped
+		m_hasdriveroffset = true;
+	}
+	else
+	{
+		m_driveroffset += (offset - m_driveroffset) * 0.01;
+	}
+
+	return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(drivermsec + m_driveroffset)));
+}
+
+void CameraCaptureThread::ResetCaptureClock()
+{
+	m_opentime = std::chrono::steady_clock::now();
+	m_firstframe = true;
+	m_hasdriveroffset = false;
+	m_driveroffset = 0;
+	m_lastdrivermsec = 0;
+}
+
 void CameraCaptureThread::SetCamera(const int32_t camera)
 {
 	m_newcamera = camera;
@@ -2,12 +2,21 @@
 
 #include "ithread.h"
 
+#include <chrono>
 #include <functional>
 #include <mutex>
 #include <cstdint>
 
+#include "captureformat.h"
+#include "framepool.h"
+
 #include <opencv2/core/mat.hpp>
 
+namespace cv
+{
+	class VideoCapture;
+}
+
 class CameraCaptureThread :public IThread
 {
 public:
@@ -23,8 +32,12 @@ public:
 
 	struct CameraCaptureThreadParameters :public IThread::ThreadParameters
 	{
-		std::function<void(const cv::Mat&)> m_sendframe;
+		std::function<void(const int32_t)> m_sendframe;		// receives ownership of a m_framepool slot
+		std::function<bool()> m_wantframe = nullptr;		// grabbed frames are only decoded when this returns true, every frame is if it's not set
+		FramePool* m_framepool{ nullptr };
 		int32_t m_camera{ 0 };
+		CaptureFormat m_format;
+		int32_t m_decimation{ 0 };							// decode every nth grabbed frame instead of asking m_wantframe, 0 to ask
 	};
 
 	void SetCamera(const int32_t camera);
@@ -37,9 +50,32 @@ private:
 
 	void Run(const IThread::ThreadParameters* threadparameters);
 
-	std::function<void(const cv::Mat&)> m_sendframe;
+	// capture time of the frame just grabbed, from the driver's timestamp when the backend reports one
+	std::chrono::steady_clock::time_point CaptureTimestamp(cv::VideoCapture& vc, const std::chrono::steady_clock::time_point grabtime);
+	void ResetCaptureClock();
+
+	bool WantFrame(const uint64_t sequence) const;
+	bool Retrieve(cv::VideoCapture& vc, cv::Mat& frame);		// decodes the grabbed frame, to BGR or to raw YUYV
+
+	std::function<void(const int32_t)> m_sendframe;
+	std::function<bool()> m_wantframe;
+	FramePool* m_framepool;
+	CaptureFormat m_format;
+	bool m_raw;									// the open camera delivers raw YUYV
+	cv::Mat m_rawframe;							// raw buffer retrieved before copying it into a frame pool slot
+	int32_t m_decimation;
 	std::atomic<CameraCaptureStatus> m_status;
 	std::atomic<int32_t> m_camera;
 	std::atomic<int32_t> m_newcamera;
+	uint64_t m_sequence;						// every grabbed frame gets the next number, skipped frames leave gaps
+	uint64_t m_grabbed;
+	std::chrono::steady_clock::time_point m_opentime;
+	bool m_firstframe;							// waiting for the first frame since the camera was opened
+	uint64_t m_decoded;
+
+	// driver timestamps are mapped onto the steady clock with the smallest grab delay seen, which follows slowly if the clocks drift apart
+	bool m_hasdriveroffset;
+	double m_driveroffset;						// ms from driver time to steady clock time
+	double m_lastdrivermsec;
 
 };
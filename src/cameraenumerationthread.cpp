@@ -0,0 +1,175 @@
+#include "cameraenumerationthread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <opencv2/videoio.hpp>
+
+#ifdef __linux__
+#include <filesystem>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#endif
+
+CameraEnumerationThread::CameraEnumerationThread() :IThread()
+{
+
+}
+
+CameraEnumerationThread::~CameraEnumerationThread()
+{
+
+}
+
+void CameraEnumerationThread::Run(const IThread::ThreadParameters* threadparameters)
+{
+	try
+	{
+		const CameraEnumerationThreadParameters params = *(dynamic_cast<const CameraEnumerationThreadParameters*>(threadparameters));
+
+		std::vector<CameraInfo> cached;
+		const bool hascache = !params.m_cachefile.empty() && LoadCache(params.m_cachefile, cached);
+		if (hascache && params.m_sendcameras)
+		{
+			params.m_sendcameras(cached);
+		}
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<CameraInfo> cameras;
+		EnumerateCameras(params.m_backend, params.m_maxcameras, cameras, hascache ? nullptr : params.m_sendcameras);
+		std::cout << "Found " << cameras.size() << " cameras in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+		if (!m_stop && params.m_sendcameras)
+		{
+			params.m_sendcameras(cameras);
+		}
+		// a stopped enumeration is incomplete and would replace a good cache with a partial list
+		if (!m_stop && !params.m_cachefile.empty() && !SaveCache(params.m_cachefile, cameras))
+		{
+			std::cout << "Couldn't save camera list to " << params.m_cachefile << std::endl;
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "CameraEnumerationThread::Run caught " << e.what() << std::endl;
+	}
+}
+
+void CameraEnumerationThread::EnumerateCameras(const CaptureBackend backend, const int32_t maxcameras, std::vector<CameraInfo>& cameras, const std::function<void(const std::vector<CameraInfo>&)>& progress) const
+{
+	cameras.clear();
+
+#ifdef __linux__
+	if (backend == CAPTURE_BACKEND_ANY || backend == CAPTURE_BACKEND_V4L2)
+	{
+		std::error_code ec;
+		for (std::filesystem::directory_iterator i("/dev", ec); !ec && i != std::filesystem::directory_iterator() && !m_stop; i.increment(ec))
+		{
+			const std::string name = (*i).path().filename().string();
+			if (name.compare(0, 5, "video") != 0 || name.size() == 5 || name.find_first_not_of("0123456789", 5) != std::string::npos)
+			{
+				continue;
+			}
+
+			const int fd = open((*i).path().c_str(), O_RDWR | O_NONBLOCK);
+			if (fd < 0)
+			{
+				continue;
+			}
+			v4l2_capability cap;
+			std::memset(&cap, 0, sizeof(cap));
+			if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0)
+			{
+				// UVC cameras also have a metadata node, only the node that captures video is a camera
+				const uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+				if ((caps & V4L2_CAP_VIDEO_CAPTURE) != 0)
+				{
+					CameraInfo ci;
+					ci.m_index = std::stoi(name.substr(5));
+					ci.m_name = reinterpret_cast<const char*>(cap.card);
+
+					// /dev isn't listed in order, keep the list sorted by index for every progress update
+					cameras.insert(std::upper_bound(cameras.begin(), cameras.end(), ci, [](const CameraInfo& a, const CameraInfo& b) { return a.m_index < b.m_index; }), ci);
+					if (progress)
+					{
+						progress(cameras);
+					}
+				}
+			}
+			close(fd);
+		}
+		return;
+	}
+#endif
+
+	for (int32_t i = 0; i < maxcameras && !m_stop; i++)
+	{
+		cv::VideoCapture vc;
+		CaptureFormat format;
+		format.m_backend = backend;
+		bool raw = false;
+		if (OpenCamera(vc, i, format, raw))
+		{
+			CameraInfo ci;
+			ci.m_index = i;
+			ci.m_name = vc.getBackendName() + " Camera " + std::to_string(i);
+			cameras.push_back(ci);
+			if (progress)
+			{
+				progress(cameras);
+			}
+		}
+	}
+}
+
+bool CameraEnumerationThread::LoadCache(const std::string& cachefile, std::vector<CameraInfo>& cameras)
+{
+	cameras.clear();
+	std::ifstream infile(cachefile);
+	if (!infile.is_open())
+	{
+		return false;
+	}
+
+	// one camera per line, index then a tab then the name
+	std::string line;
+	while (std::getline(infile, line))
+	{
+		const std::string::size_type pos = line.find('\t');
+		if (pos == std::string::npos || pos == 0)
+		{
+			continue;
+		}
+		try
+		{
+			CameraInfo ci;
+			ci.m_index = std::stoi(line.substr(0, pos));
+			ci.m_name = line.substr(pos + 1);
+			cameras.push_back(ci);
+		}
+		catch (std::exception&)
+		{
+		}
+	}
+	return true;
+}
+
+bool CameraEnumerationThread::SaveCache(const std::string& cachefile, const std::vector<CameraInfo>& cameras)
+{
+	std::ofstream outfile(cachefile, std::ios::trunc);
+	if (!outfile.is_open())
+	{
+		return false;
+	}
+	for (std::vector<CameraInfo>::const_iterator i = cameras.begin(); i != cameras.end(); i++)
+	{
+		outfile << (*i).m_index << '\t' << (*i).m_name << '\n';
+	}
+	return outfile.good();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ithread.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "captureformat.h"
+
+struct CameraInfo
+{
+	int32_t m_index{ -1 };				// index passed to cv::VideoCapture::open
+	std::string m_name{ "" };
+};
+
+/*
+
+	Finds the cameras on a background thread so the window doesn't wait for it
+	The list saved by the last run is sent first, then the list found now once enumeration finishes, which is saved for the next run
+	Without a saved list the cameras are sent as they're found
+
+	On Linux the /dev/video* nodes are queried for their V4L2 capabilities, which doesn't start a stream or wait on missing devices
+	Elsewhere each index is opened with OpenCV
+
+*/
+
+class CameraEnumerationThread :public IThread
+{
+public:
+	CameraEnumerationThread();
+	virtual ~CameraEnumerationThread();
+
+	struct CameraEnumerationThreadParameters :public IThread::ThreadParameters
+	{
+		std::function<void(const std::vector<CameraInfo>&)> m_sendcameras = nullptr;
+		std::string m_cachefile{ "" };			// empty to always enumerate without a cache
+		CaptureBackend m_backend{ CAPTURE_BACKEND_ANY };
+		int32_t m_maxcameras{ 10 };				// indexes tried when opening each one with OpenCV
+	};
+
+	static bool LoadCache(const std::string& cachefile, std::vector<CameraInfo>& cameras);
+	static bool SaveCache(const std::string& cachefile, const std::vector<CameraInfo>& cameras);
+
+private:
+
+	void Run(const IThread::ThreadParameters* threadparameters);
+
+	// progress gets the cameras found so far each time another one is found, it can be null
+	void EnumerateCameras(const CaptureBackend backend, const int32_t maxcameras, std::vector<CameraInfo>& cameras, const std::function<void(const std::vector<CameraInfo>&)>& progress) const;
+
+};
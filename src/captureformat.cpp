@@ -0,0 +1,309 @@
+#include "captureformat.h"
+
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/videoio.hpp>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#endif
+
+std::array<std::string, CaptureBackend::CAPTURE_BACKEND_MAX> CaptureBackendName{ "any","v4l2","gstreamer","ffmpeg","dshow","msmf" };
+
+namespace
+{
+
+int CaptureAPI(const CaptureBackend backend)
+{
+	switch (backend)
+	{
+	case CAPTURE_BACKEND_V4L2:
+		return cv::CAP_V4L2;
+	case CAPTURE_BACKEND_GSTREAMER:
+		return cv::CAP_GSTREAMER;
+	case CAPTURE_BACKEND_FFMPEG:
+		return cv::CAP_FFMPEG;
+	case CAPTURE_BACKEND_DSHOW:
+		return cv::CAP_DSHOW;
+	case CAPTURE_BACKEND_MSMF:
+		return cv::CAP_MSMF;
+	case CAPTURE_BACKEND_ANY:
+	default:
+		return cv::CAP_ANY;
+	}
+}
+
+std::string FourCCString(const double fourcc)
+{
+	const uint32_t code = static_cast<uint32_t>(fourcc);
+	std::string str;
+	for (int32_t i = 0; i < 4; i++)
+	{
+		const char c = static_cast<char>((code >> (i * 8)) & 0xff);
+		str.push_back((c >= 32 && c < 127) ? c : '?');
+	}
+	return (code == 0) ? std::string("default") : str;
+}
+
+// order matters to V4L2, the pixel format has to be set before the size and the size before the frame rate
+void SetCaptureFormat(cv::VideoCapture& vc, const CaptureFormat& format)
+{
+	if (format.m_fourcc.size() == 4)
+	{
+		vc.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc(format.m_fourcc[0], format.m_fourcc[1], format.m_fourcc[2], format.m_fourcc[3]));
+	}
+	if (format.m_width > 0 && format.m_height > 0)
+	{
+		vc.set(cv::CAP_PROP_FRAME_WIDTH, format.m_width);
+		vc.set(cv::CAP_PROP_FRAME_HEIGHT, format.m_height);
+	}
+	if (format.m_fps > 0)
+	{
+		vc.set(cv::CAP_PROP_FPS, format.m_fps);
+	}
+}
+
+// fourcc, width, height, frames per second
+typedef std::tuple<std::string, int32_t, int32_t, double> CaptureMode;
+
+// sizes tried by the probe, and by V4L2 cameras that report a range of sizes instead of a list
+const std::vector<std::pair<int32_t, int32_t>> CommonSizes{ {320,240},{424,240},{640,360},{640,480},{800,600},{960,540},{1280,720},{1920,1080} };
+
+#ifdef __linux__
+
+int V4L2Ioctl(const int fd, const unsigned long request, void* arg)
+{
+	int result = 0;
+	do
+	{
+		result = ioctl(fd, request, arg);
+	} while (result < 0 && errno == EINTR);
+	return result;
+}
+
+double IntervalFPS(const v4l2_fract& interval)
+{
+	return (interval.numerator > 0) ? static_cast<double>(interval.denominator) / static_cast<double>(interval.numerator) : 0.0;
+}
+
+void ListV4L2Rates(const int fd, const uint32_t pixelformat, const std::string& fourcc, const int32_t width, const int32_t height, std::set<CaptureMode>& modes)
+{
+	v4l2_frmivalenum interval;
+	std::memset(&interval, 0, sizeof(interval));
+	interval.pixel_format = pixelformat;
+	interval.width = static_cast<uint32_t>(width);
+	interval.height = static_cast<uint32_t>(height);
+
+	bool found = false;
+	while (V4L2Ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0)
+	{
+		found = true;
+		if (interval.type == V4L2_FRMIVAL_TYPE_DISCRETE)
+		{
+			modes.insert(std::make_tuple(fourcc, width, height, IntervalFPS(interval.discrete)));
+			interval.index++;
+		}
+		else
+		{
+			// a range, the shortest interval is the fastest rate
+			modes.insert(std::make_tuple(fourcc, width, height, IntervalFPS(interval.stepwise.max)));
+			modes.insert(std::make_tuple(fourcc, width, height, IntervalFPS(interval.stepwise.min)));
+			break;
+		}
+	}
+	if (!found)
+	{
+		modes.insert(std::make_tuple(fourcc, width, height, 0.0));
+	}
+}
+
+// asks the driver for every pixel format, size and frame interval, false if /dev/video<camera> can't be queried
+bool ListV4L2Modes(const int32_t camera, std::set<CaptureMode>& modes)
+{
+	const std::string path = "/dev/video" + std::to_string(camera);
+	const int fd = open(path.c_str(), O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	v4l2_fmtdesc format;
+	std::memset(&format, 0, sizeof(format));
+	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	while (V4L2Ioctl(fd, VIDIOC_ENUM_FMT, &format) == 0)
+	{
+		const std::string fourcc = FourCCString(static_cast<double>(format.pixelformat));
+
+		v4l2_frmsizeenum size;
+		std::memset(&size, 0, sizeof(size));
+		size.pixel_format = format.pixelformat;
+		while (V4L2Ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0)
+		{
+			if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE)
+			{
+				ListV4L2Rates(fd, format.pixelformat, fourcc, static_cast<int32_t>(size.discrete.width), static_cast<int32_t>(size.discrete.height), modes);
+				size.index++;
+				continue;
+			}
+
+			// a range of sizes, list the common ones inside it and the largest
+			const v4l2_frmsize_stepwise& range = size.stepwise;
+			for (std::vector<std::pair<int32_t, int32_t>>::const_iterator s = CommonSizes.begin(); s != CommonSizes.end(); s++)
+			{
+				const uint32_t width = static_cast<uint32_t>((*s).first);
+				const uint32_t height = static_cast<uint32_t>((*s).second);
+				if (width >= range.min_width && width <= range.max_width && height >= range.min_height && height <= range.max_height &&
+					(range.step_width == 0 || (width - range.min_width) % range.step_width == 0) && (range.step_height == 0 || (height - range.min_height) % range.step_height == 0))
+				{
+					ListV4L2Rates(fd, format.pixelformat, fourcc, (*s).first, (*s).second, modes);
+				}
+			}
+			ListV4L2Rates(fd, format.pixelformat, fourcc, static_cast<int32_t>(range.max_width), static_cast<int32_t>(range.max_height), modes);
+			break;
+		}
+		format.index++;
+	}
+
+	close(fd);
+	return true;
+}
+
+#endif
+
+}	// namespace
+
+bool GetCaptureBackend(const std::string& name, CaptureBackend& backend)
+{
+	for (size_t i = 0; i < CaptureBackendName.size(); i++)
+	{
+		if (CaptureBackendName[i] == name)
+		{
+			backend = static_cast<CaptureBackend>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool OpenCamera(cv::VideoCapture& vc, const int32_t camera, const CaptureFormat& format, bool& raw)
+{
+	raw = false;
+	if (!vc.open(camera, CaptureAPI(format.m_backend)))
+	{
+		return false;
+	}
+	SetCaptureFormat(vc, format);
+
+	if (format.m_raw)
+	{
+		// MJPEG and other compressed formats have to be decoded anyway
+		const std::string fourcc = FourCCString(vc.get(cv::CAP_PROP_FOURCC));
+		if ((fourcc == "YUYV" || fourcc == "YUY2") && vc.set(cv::CAP_PROP_CONVERT_RGB, 0))
+		{
+			raw = true;
+		}
+		else
+		{
+			std::cout << "Camera " << camera << " is sending " << fourcc << ", raw capture needs YUYV - frames will be converted to BGR" << std::endl;
+		}
+	}
+
+	std::cout << "Camera " << camera << " opened with " << vc.getBackendName() << " " << DescribeCaptureMode(vc) << (raw ? " raw" : "") << std::endl;
+	return true;
+}
+
+bool CopyRawYUYV(const cv::Mat& raw, const int32_t width, const int32_t height, cv::Mat& frame)
+{
+	if (raw.type() == CV_8UC2 && raw.cols == width && raw.rows == height)
+	{
+		raw.copyTo(frame);
+		return true;
+	}
+
+	// most backends hand back the driver's buffer as a single row of bytes
+	const size_t bytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 2;
+	if (width < 2 || height < 1 || !raw.isContinuous() || (raw.total() * raw.elemSize()) < bytes)
+	{
+		return false;
+	}
+	frame.create(height, width, CV_8UC2);
+	std::memcpy(frame.data, raw.data, bytes);
+	return true;
+}
+
+std::string DescribeCaptureMode(const cv::VideoCapture& vc)
+{
+	std::ostringstream ostr;
+	ostr << FourCCString(vc.get(cv::CAP_PROP_FOURCC)) << " " << static_cast<int32_t>(vc.get(cv::CAP_PROP_FRAME_WIDTH)) << "x" << static_cast<int32_t>(vc.get(cv::CAP_PROP_FRAME_HEIGHT)) << " @ " << vc.get(cv::CAP_PROP_FPS);
+	return ostr.str();
+}
+
+void ProbeCameras(const CaptureBackend backend, const int32_t maxcameras)
+{
+	// OpenCV can't list a camera's modes, V4L2 cameras are asked directly, anything else is asked for each of these and we keep what the backend says it switched to
+	const std::vector<std::string> fourccs{ "MJPG","YUYV","NV12" };
+	const std::vector<double> rates{ 15,30,60 };
+
+	for (int32_t camera = 0; camera < maxcameras; camera++)
+	{
+		cv::VideoCapture vc;
+		if (!vc.open(camera, CaptureAPI(backend)))
+		{
+			continue;
+		}
+
+		std::cout << "Camera " << camera << " (" << vc.getBackendName() << ") default " << DescribeCaptureMode(vc) << std::endl;
+
+		std::set<CaptureMode> modes;
+		bool listed = false;
+#ifdef __linux__
+		listed = ListV4L2Modes(camera, modes);
+#endif
+		for (std::vector<std::string>::const_iterator f = fourccs.begin(); f != fourccs.end() && !listed; f++)
+		{
+			for (std::vector<std::pair<int32_t, int32_t>>::const_iterator s = CommonSizes.begin(); s != CommonSizes.end(); s++)
+			{
+				for (std::vector<double>::const_iterator r = rates.begin(); r != rates.end(); r++)
+				{
+					CaptureFormat format;
+					format.m_fourcc = (*f);
+					format.m_width = (*s).first;
+					format.m_height = (*s).second;
+					format.m_fps = (*r);
+					SetCaptureFormat(vc, format);
+
+					// only count modes that actually deliver a frame of the size asked for
+					cv::Mat frame;
+					const std::string fourcc = FourCCString(vc.get(cv::CAP_PROP_FOURCC));
+					if (fourcc == format.m_fourcc && vc.read(frame) && frame.cols == format.m_width && frame.rows == format.m_height)
+					{
+						modes.insert(std::make_tuple(fourcc, frame.cols, frame.rows, static_cast<double>(static_cast<int32_t>(vc.get(cv::CAP_PROP_FPS) + 0.5))));
+					}
+				}
+			}
+		}
+
+		for (std::set<CaptureMode>::const_iterator i = modes.begin(); i != modes.end(); i++)
+		{
+			std::cout << "  " << std::get<0>(*i) << " " << std::get<1>(*i) << "x" << std::get<2>(*i);
+			if (std::get<3>(*i) > 0)
+			{
+				std::cout << " @ " << std::get<3>(*i);
+			}
+			std::cout << std::endl;
+		}
+		if (modes.empty())
+		{
+			std::cout << (listed ? "  no capture formats reported" : "  no common modes accepted") << std::endl;
+		}
+	}
+}
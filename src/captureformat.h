@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core/mat.hpp>
+
+namespace cv
+{
+	class VideoCapture;
+}
+
+enum CaptureBackend
+{
+	CAPTURE_BACKEND_ANY = 0,
+	CAPTURE_BACKEND_V4L2,
+	CAPTURE_BACKEND_GSTREAMER,
+	CAPTURE_BACKEND_FFMPEG,
+	CAPTURE_BACKEND_DSHOW,
+	CAPTURE_BACKEND_MSMF,
+	CAPTURE_BACKEND_MAX
+};
+
+extern std::array<std::string, CaptureBackend::CAPTURE_BACKEND_MAX> CaptureBackendName;		// names used on the command line
+
+bool GetCaptureBackend(const std::string& name, CaptureBackend& backend);
+
+// camera mode to ask the backend for, anything left at 0 or empty is left at the backend's default
+struct CaptureFormat
+{
+	CaptureBackend m_backend{ CAPTURE_BACKEND_ANY };
+	std::string m_fourcc{ "" };				// e.g. MJPG, YUYV, NV12
+	int32_t m_width{ 0 };
+	int32_t m_height{ 0 };
+	double m_fps{ 0 };
+	bool m_raw{ false };					// deliver YUYV frames without converting them to BGR, only when the camera is sending YUYV
+};
+
+// opens the camera and requests the format, the backend may pick the closest mode it supports instead
+// raw is set when frames come back as unconverted YUYV, returns false if the camera can't be opened
+bool OpenCamera(cv::VideoCapture& vc, const int32_t camera, const CaptureFormat& format, bool& raw);
+
+// raw YUYV buffer from retrieve() to a width x height 2 channel frame, returns false if the buffer is too small
+bool CopyRawYUYV(const cv::Mat& raw, const int32_t width, const int32_t height, cv::Mat& frame);
+
+// the mode the camera is actually running in e.g. MJPG 640x480 @ 30
+std::string DescribeCaptureMode(const cv::VideoCapture& vc);
+
+// prints the modes each camera supports, V4L2 cameras on Linux list them, elsewhere common resolutions, FOURCCs and frame rates are tried and the ones the backend accepts are kept
+void ProbeCameras(const CaptureBackend backend, const int32_t maxcameras);
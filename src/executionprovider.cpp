@@ -0,0 +1,91 @@
+#include "executionprovider.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <dml/dml_provider_factory.h>
+#endif
+
+std::array<std::string, ExecutionProvider::EXECUTION_PROVIDER_MAX> ExecutionProviderName{ "cpu","xnnpack","openvino","dml" };
+
+bool GetExecutionProvider(const std::string& name, ExecutionProvider& provider)
+{
+	for (size_t i = 0; i < ExecutionProviderName.size(); i++)
+	{
+		if (ExecutionProviderName[i] == name)
+		{
+			provider = static_cast<ExecutionProvider>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ParseExecutionProviderOptions(const std::string& options, ExecutionProviderOptions& provideroptions)
+{
+	std::istringstream istr(options);
+	std::string option;
+	while (std::getline(istr, option, ';'))
+	{
+		if (option.empty())
+		{
+			continue;
+		}
+		const std::string::size_type pos = option.find('=');
+		if (pos == std::string::npos || pos == 0)
+		{
+			return false;
+		}
+		provideroptions[option.substr(0, pos)] = option.substr(pos + 1);
+	}
+	return true;
+}
+
+void AppendExecutionProvider(Ort::SessionOptions& session_options, const ExecutionProvider provider, const ExecutionProviderOptions& provideroptions)
+{
+	const std::unordered_map<std::string, std::string> options(provideroptions.begin(), provideroptions.end());
+
+	switch (provider)
+	{
+	case EXECUTION_PROVIDER_CPU:
+		break;
+	case EXECUTION_PROVIDER_XNNPACK:
+		// XNNPACK runs its own thread pool (intra_op_num_threads option), thread spinning defaults to off for it in main
+		session_options.AppendExecutionProvider("XNNPACK", options);
+		break;
+	case EXECUTION_PROVIDER_OPENVINO:
+	{
+		std::unordered_map<std::string, std::string> openvinooptions(options);
+		if (openvinooptions.find("device_type") == openvinooptions.end())
+		{
+			openvinooptions["device_type"] = "CPU";
+		}
+		session_options.AppendExecutionProvider_OpenVINO_V2(openvinooptions);
+		break;
+	}
+	case EXECUTION_PROVIDER_DML:
+	{
+#ifdef _WIN32
+		session_options.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+		session_options.DisableMemPattern();
+
+		ExecutionProviderOptions::const_iterator deviceid = provideroptions.find("device_id");
+
+		OrtApi const& ortApi = Ort::GetApi();
+		OrtDmlApi const* ortDmlApi = nullptr;
+		Ort::ThrowOnError(ortApi.GetExecutionProviderApi("DML", ORT_API_VERSION, reinterpret_cast<void const**>(&ortDmlApi)));
+
+		ortApi.AddFreeDimensionOverrideByName(session_options, "batch_size", 1); // If your model has this dimension
+
+		Ort::ThrowOnError(ortDmlApi->SessionOptionsAppendExecutionProvider_DML(session_options, deviceid != provideroptions.end() ? std::stoi((*deviceid).second) : 0));
+#else
+		throw std::runtime_error("DirectML execution provider is only available on Windows");
+#endif
+		break;
+	}
+	default:
+		throw std::runtime_error("Unknown execution provider");
+	}
+}
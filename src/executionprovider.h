@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <string>
+
+#include <onnxruntime_cxx_api.h>
+
+enum ExecutionProvider
+{
+	EXECUTION_PROVIDER_CPU = 0,
+	EXECUTION_PROVIDER_XNNPACK,
+	EXECUTION_PROVIDER_OPENVINO,
+	EXECUTION_PROVIDER_DML,
+	EXECUTION_PROVIDER_MAX
+};
+
+extern std::array<std::string, ExecutionProvider::EXECUTION_PROVIDER_MAX> ExecutionProviderName;		// names used on the command line
+
+typedef std::map<std::string, std::string> ExecutionProviderOptions;
+
+bool GetExecutionProvider(const std::string& name, ExecutionProvider& provider);
+
+// options are key=value pairs separated by ;
+bool ParseExecutionProviderOptions(const std::string& options, ExecutionProviderOptions& provideroptions);
+
+// throws if the provider isn't available in this build of ONNX Runtime or on this platform
+void AppendExecutionProvider(Ort::SessionOptions& session_options, const ExecutionProvider provider, const ExecutionProviderOptions& provideroptions);
@@ -0,0 +1,278 @@
+#include "filecapturethread.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+std::array<std::string, FilePacing::FILE_PACING_MAX> FilePacingName{ "realtime","fast","fixed" };
+
+bool GetFilePacing(const std::string& name, FilePacing& pacing)
+{
+	for (size_t i = 0; i < FilePacingName.size(); i++)
+	{
+		if (FilePacingName[i] == name)
+		{
+			pacing = static_cast<FilePacing>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+FileCaptureThread::FileCaptureThread() :IThread(), m_framepending(nullptr), m_framepool(nullptr), m_video(nullptr), m_nextimage(0), m_fps(30)
+{
+
+}
+
+FileCaptureThread::~FileCaptureThread()
+{
+	if (m_video)
+	{
+		delete m_video;
+		m_video = nullptr;
+	}
+}
+
+void FileCaptureThread::FrameTaken()
+{
+	{
+		// empty lock so the notify can't slip in between the source checking m_framepending and starting to wait
+		std::lock_guard<std::mutex> guard(m_takenmutex);
+	}
+	m_takencv.notify_one();
+}
+
+void FileCaptureThread::Stop()
+{
+	IThread::Stop();
+	FrameTaken();
+}
+
+void FileCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
+{
+	try
+	{
+		const FileCaptureThreadParameters params = *(dynamic_cast<const FileCaptureThreadParameters*>(threadparameters));
+		m_sendframe = params.m_sendframe;
+		m_framepending = params.m_framepending;
+		m_framepool = params.m_framepool;
+
+		if (!OpenInput(params.m_path))
+		{
+			throw std::runtime_error("Couldn't open input " + params.m_path);
+		}
+		if (params.m_fps > 0 && (params.m_pacing == FILE_PACING_FIXED || !m_video))
+		{
+			m_fps = params.m_fps;
+		}
+		// frames sent while the models are still loading would only be dropped
+		while (!m_stop && params.m_ready && !params.m_ready())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		std::cout << "Reading " << params.m_path << " at " << ((params.m_pacing == FILE_PACING_FAST) ? std::string("full speed") : std::to_string(m_fps) + " fps") << std::endl;
+
+		// media time 0 is when the input started, each loop carries on from where the last one ended
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double loopoffset = 0;
+		double lastmediamsec = 0;
+		uint64_t sequence = 0;
+		uint64_t sent = 0;
+		while (!m_stop)
+		{
+			// read straight into a recycled buffer, or throw the frame away if they're all busy downstream
+			// fast pacing waits for a buffer instead, it mustn't drop anything
+			int32_t slot = m_framepool ? m_framepool->Acquire() : -1;
+			while (slot < 0 && m_framepool && params.m_pacing == FILE_PACING_FAST && !m_stop)
+			{
+				slot = m_framepool->Acquire(std::chrono::milliseconds(10));
+			}
+			if (m_stop)
+			{
+				if (slot >= 0)
+				{
+					m_framepool->Release(slot);
+				}
+				break;
+			}
+			double mediamsec = 0;
+			if (!NextFrame((slot >= 0) ? m_framepool->Frame(slot) : m_dropped, mediamsec))
+			{
+				if (slot >= 0)
+				{
+					m_framepool->Release(slot);
+				}
+				if (params.m_loop && sequence > 0 && OpenInput(params.m_path))
+				{
+					loopoffset = lastmediamsec + (1000.0 / m_fps);
+					continue;
+				}
+				break;
+			}
+			mediamsec += loopoffset;
+			lastmediamsec = mediamsec;
+			sequence++;
+
+			const std::chrono::steady_clock::time_point timestamp = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(mediamsec));
+			bool waited = true;
+			switch (params.m_pacing)
+			{
+			case FILE_PACING_REALTIME:
+				waited = WaitUntil(timestamp);
+				break;
+			case FILE_PACING_FIXED:
+				waited = WaitUntil(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(static_cast<double>(sequence - 1) / m_fps)));
+				break;
+			case FILE_PACING_FAST:
+			default:
+				if (m_framepending)
+				{
+					std::unique_lock<std::mutex> lock(m_takenmutex);
+					m_takencv.wait(lock, [this]() { return m_stop || !m_framepending(); });
+				}
+				waited = !m_stop;
+				break;
+			}
+			if (!waited || slot < 0)
+			{
+				if (slot >= 0)
+				{
+					m_framepool->Release(slot);
+				}
+				if (!waited)
+				{
+					break;
+				}
+				continue;
+			}
+
+			m_framepool->Sequence(slot) = sequence;
+			m_framepool->Timestamp(slot) = timestamp;
+			sent++;
+			if (m_sendframe)
+			{
+				m_sendframe(slot);
+			}
+			else
+			{
+				m_framepool->Release(slot);
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Sent " << sent << " of " << sequence << " frames in " << seconds << " s (" << ((seconds > 0) ? static_cast<double>(sent) / seconds : 0.0) << " fps)" << std::endl;
+
+		if (!m_stop)
+		{
+			// let the detector finish the last frames before saying the input is done
+			while (!m_stop && params.m_idle && !params.m_idle())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			if (params.m_finished)
+			{
+				params.m_finished();
+			}
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "FileCaptureThread::Run caught " << e.what() << std::endl;
+	}
+
+	if (m_video)
+	{
+		delete m_video;
+		m_video = nullptr;
+	}
+
+	std::cout << "FileCaptureThread::Run Thread Complete" << std::endl;
+}
+
+bool FileCaptureThread::OpenInput(const std::string& path)
+{
+	if (m_video)
+	{
+		delete m_video;
+		m_video = nullptr;
+	}
+	m_images.clear();
+	m_nextimage = 0;
+
+	std::error_code ec;
+	if (std::filesystem::is_directory(path, ec))
+	{
+		for (std::filesystem::directory_iterator i(path, ec); !ec && i != std::filesystem::directory_iterator(); i.increment(ec))
+		{
+			std::string extension = (*i).path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+			if ((*i).is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp"))
+			{
+				m_images.push_back((*i).path().string());
+			}
+		}
+		std::sort(m_images.begin(), m_images.end());
+		return !m_images.empty();
+	}
+
+	m_video = new cv::VideoCapture(path);
+	if (!m_video->isOpened())
+	{
+		delete m_video;
+		m_video = nullptr;
+		return false;
+	}
+	const double fps = m_video->get(cv::CAP_PROP_FPS);
+	if (fps > 0 && fps < 1000)
+	{
+		m_fps = fps;
+	}
+	return true;
+}
+
+bool FileCaptureThread::NextFrame(cv::Mat& frame, double& mediamsec)
+{
+	if (m_video)
+	{
+		if (!m_video->read(frame) || frame.empty())
+		{
+			return false;
+		}
+		mediamsec = m_video->get(cv::CAP_PROP_POS_MSEC);		// presentation time of the frame just read
+		return true;
+	}
+
+	while (m_nextimage < m_images.size())
+	{
+		const size_t index = m_nextimage++;
+		frame = cv::imread(m_images[index]);
+		if (!frame.empty())
+		{
+			mediamsec = (static_cast<double>(index) * 1000.0) / m_fps;
+			return true;
+		}
+		std::cout << "Skipping unreadable image " << m_images[index] << std::endl;
+	}
+	return false;
+}
+
+bool FileCaptureThread::WaitUntil(const std::chrono::steady_clock::time_point time)
+{
+	while (!m_stop)
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now >= time)
+		{
+			return true;
+		}
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(time - now, std::chrono::milliseconds(10)));
+	}
+	return false;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ithread.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "framepool.h"
+
+#include <opencv2/core/mat.hpp>
+
+namespace cv
+{
+	class VideoCapture;
+}
+
+enum FilePacing
+{
+	FILE_PACING_REALTIME = 0,		// frames are sent at the media frame rate, the detector drops what it can't keep up with like a camera
+	FILE_PACING_FAST,				// each frame is sent as soon as the detector has taken the last one, waiting for a free frame pool slot if needed so nothing is dropped
+	FILE_PACING_FIXED,				// frames are sent at m_fps no matter what the media frame rate is
+	FILE_PACING_MAX
+};
+
+extern std::array<std::string, FilePacing::FILE_PACING_MAX> FilePacingName;		// names used on the command line
+
+bool GetFilePacing(const std::string& name, FilePacing& pacing);
+
+/*
+
+	Frame source reading a video file or a directory of images instead of a camera
+	Frames are timestamped from media time, so a recording gives the same timestamps whatever speed it's processed at
+	Image directories are read in file name order at m_fps
+
+*/
+
+class FileCaptureThread :public IThread
+{
+public:
+	FileCaptureThread();
+	virtual ~FileCaptureThread();
+
+	struct FileCaptureThreadParameters :public IThread::ThreadParameters
+	{
+		std::function<void(const int32_t)> m_sendframe;		// receives ownership of a m_framepool slot
+		std::function<bool()> m_framepending = nullptr;		// true while the last frame sent hasn't been taken yet, FILE_PACING_FAST waits for FrameTaken until it's false
+		std::function<bool()> m_ready = nullptr;			// true once the detector can take frames, nothing is read before then
+		std::function<bool()> m_idle = nullptr;				// true once everything sent has been processed, checked before m_finished
+		std::function<void()> m_finished = nullptr;			// called at the end of the input when not looping
+		FramePool* m_framepool{ nullptr };
+		std::string m_path{ "" };
+		FilePacing m_pacing{ FILE_PACING_REALTIME };
+		double m_fps{ 0 };									// rate for FILE_PACING_FIXED and image directories, 0 uses the video's rate or 30
+		bool m_loop{ false };
+	};
+
+	void FrameTaken();		// wire to the detector's m_frametaken
+
+	void Stop();
+
+private:
+
+	void Run(const IThread::ThreadParameters* threadparameters);
+
+	bool OpenInput(const std::string& path);
+	bool NextFrame(cv::Mat& frame, double& mediamsec);		// false at the end of the input
+	bool WaitUntil(const std::chrono::steady_clock::time_point time);		// false if stopped while waiting
+
+	std::function<void(const int32_t)> m_sendframe;
+	std::function<bool()> m_framepending;
+	FramePool* m_framepool;
+	std::mutex m_takenmutex;
+	std::condition_variable m_takencv;					// signalled when the detector takes a frame or the thread is stopped
+
+	cv::VideoCapture* m_video;							// null when reading images
+	std::vector<std::string> m_images;
+	size_t m_nextimage;
+	double m_fps;
+	cv::Mat m_dropped;									// frames read while every frame pool slot is busy
+
+};
@@ -23,7 +23,6 @@
 //<*includes
 
 #include "global.h"
-#include <opencv2/videoio.hpp>
 
 //debug
 #include <iostream>
@@ -44,15 +43,7 @@ public:
 		events().unload(std::bind([]() { global::stop = true; }));												// (Upper right X clicked)
 		MenuMain.at(0).answerer(0, std::bind(&FormMain::ClickExit,this,std::placeholders::_1));	// File -> Exit clicked
 
-		// get list of available cameras
-		cv::VideoCapture vc;
-		for (int i = 0; i < 20; i++)
-		{
-			if (vc.open(i))
-			{
-				ComboCamera.push_back(vc.getBackendName() + " Camera " + std::to_string(i));
-			}
-		}
+		// cameras are filled in by GUIThread as CameraEnumerationThread finds them
 
 		//ComboCamera.events().text_changed(std::bind([this]() { std::cout << ComboCamera.option(); }));
 
@@ -0,0 +1,122 @@
+#include "framepool.h"
+
+FramePool::FramePool(const int32_t size) :m_frames((size > 0 && size <= MAX_SIZE) ? size : DEFAULT_SIZE), m_sequences(m_frames.size(), 0), m_timestamps(m_frames.size()), m_inuse(0), m_refs(m_frames.size()), m_latest(-1), m_waiters(0)
+{
+
+}
+
+FramePool::~FramePool()
+{
+
+}
+
+int32_t FramePool::Acquire()
+{
+	uint32_t inuse = m_inuse.load();
+	for (int32_t slot = 0; slot < static_cast<int32_t>(m_frames.size());)
+	{
+		const uint32_t bit = (1u << slot);
+		if ((inuse & bit) != 0)
+		{
+			slot++;
+		}
+		else if (m_inuse.compare_exchange_weak(inuse, inuse | bit))
+		{
+			m_refs[slot] = 1;
+			return slot;
+		}
+		// else inuse was reloaded by the failed exchange - try the same slot again
+	}
+	return -1;
+}
+
+int32_t FramePool::Acquire(const std::chrono::milliseconds wait)
+{
+	int32_t slot = Acquire();
+	if (slot < 0)
+	{
+		std::unique_lock<std::mutex> lock(m_freemutex);
+		m_waiters++;
+		m_freecv.wait_for(lock, wait, [this, &slot]() { return (slot = Acquire()) >= 0; });
+		m_waiters--;
+	}
+	return slot;
+}
+
+void FramePool::AddRef(const int32_t slot)
+{
+	if (slot >= 0 && slot < static_cast<int32_t>(m_frames.size()))
+	{
+		m_refs[slot].fetch_add(1);
+	}
+}
+
+void FramePool::Release(const int32_t slot)
+{
+	if (slot >= 0 && slot < static_cast<int32_t>(m_frames.size()) && m_refs[slot].fetch_sub(1) == 1)
+	{
+		m_inuse.fetch_and(~(1u << slot));
+		if (m_waiters > 0)
+		{
+			// empty lock so the notify can't slip in between a waiter failing to acquire and starting to wait
+			{
+				std::lock_guard<std::mutex> guard(m_freemutex);
+			}
+			m_freecv.notify_all();
+		}
+	}
+}
+
+cv::Mat& FramePool::Frame(const int32_t slot)
+{
+	return m_frames[slot];
+}
+
+const cv::Mat& FramePool::Frame(const int32_t slot) const
+{
+	return m_frames[slot];
+}
+
+uint64_t& FramePool::Sequence(const int32_t slot)
+{
+	return m_sequences[slot];
+}
+
+uint64_t FramePool::Sequence(const int32_t slot) const
+{
+	return m_sequences[slot];
+}
+
+std::chrono::steady_clock::time_point& FramePool::Timestamp(const int32_t slot)
+{
+	return m_timestamps[slot];
+}
+
+std::chrono::steady_clock::time_point FramePool::Timestamp(const int32_t slot) const
+{
+	return m_timestamps[slot];
+}
+
+void FramePool::Publish(const int32_t slot)
+{
+	const int32_t previous = m_latest.exchange(slot);
+	if (previous >= 0)
+	{
+		Release(previous);		// consumer didn't keep up with this frame
+	}
+}
+
+int32_t FramePool::TakeLatest()
+{
+	return m_latest.exchange(-1);
+}
+
+bool FramePool::HasLatest() const
+{
+	return m_latest.load() >= 0;
+}
+
+int32_t FramePool::Size() const
+{
+	return static_cast<int32_t>(m_frames.size());
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+/*
+
+	Fixed set of frame buffers shared between a frame source and the pose detector
+	Frames are passed around by slot index, so handing a frame over never allocates or touches the cv::Mat refcount
+	Each buffer is allocated the first time a frame is decoded into it and reused afterwards as long as the frame size doesn't change
+	Frames are BGR, or YUYV (2 channels) when the camera is captured raw
+
+	The most recent frame is handed to the consumer through a single lock free mailbox slot
+	Publishing a new frame recycles the previous one if the consumer didn't take it yet
+
+	A slot can be held by more than one consumer with AddRef, it goes back to the pool when each of them has released it
+	Sources that mustn't drop frames can wait for a slot to be released instead of polling
+
+*/
+
+class FramePool
+{
+public:
+	FramePool(const int32_t size = DEFAULT_SIZE);
+	~FramePool();
+
+	static constexpr int32_t DEFAULT_SIZE = 16;
+	static constexpr int32_t MAX_SIZE = 32;
+
+	int32_t Acquire();							// returns a free slot or -1 if all slots are in use
+	int32_t Acquire(const std::chrono::milliseconds wait);		// same, waiting up to wait for a slot to be released
+	void AddRef(const int32_t slot);			// caller must already hold the slot
+	void Release(const int32_t slot);
+
+	cv::Mat& Frame(const int32_t slot);
+	const cv::Mat& Frame(const int32_t slot) const;
+	// frame number and capture time, set by the frame source before it sends the slot on
+	uint64_t& Sequence(const int32_t slot);
+	uint64_t Sequence(const int32_t slot) const;
+	std::chrono::steady_clock::time_point& Timestamp(const int32_t slot);
+	std::chrono::steady_clock::time_point Timestamp(const int32_t slot) const;
+
+	void Publish(const int32_t slot);			// slot becomes the latest frame, ownership moves to the mailbox
+	int32_t TakeLatest();						// returns the latest frame (caller must Release it) or -1 if there isn't one
+	bool HasLatest() const;
+
+	int32_t Size() const;
+
+private:
+
+	std::vector<cv::Mat> m_frames;
+	std::vector<uint64_t> m_sequences;
+	std::vector<std::chrono::steady_clock::time_point> m_timestamps;
+	std::atomic<uint32_t> m_inuse;				// bit per slot
+	std::vector<std::atomic<int32_t>> m_refs;	// holders of each slot in use
+	std::atomic<int32_t> m_latest;
+	std::mutex m_freemutex;
+	std::condition_variable m_freecv;			// signalled when a slot is released while someone is waiting for one
+	std::atomic<int32_t> m_waiters;
+
+};
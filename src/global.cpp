@@ -19,4 +19,16 @@ namespace global
 		wcstring = std::wstring(wcbuff.begin(), wcbuff.begin() + len);
 	}
 
+	uint64_t HashFNV1a(const void* data, const size_t size, const uint64_t hash)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t h = hash;
+		for (size_t i = 0; i < size; i++)
+		{
+			h ^= bytes[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
 }	// namespace global
\ No newline at end of file
@@ -9,15 +9,57 @@ struct ProgramOptions
 	std::string m_restimhost;
 	int32_t m_restimport;
 
-	bool m_directml;
-	int32_t m_dmldevid;
+	std::string m_executionprovider;
+	std::string m_executionprovideroptions;
 	int32_t m_camera;
+	std::string m_capturebackend;
+	std::string m_capturefourcc;
+	int32_t m_capturewidth;
+	int32_t m_captureheight;
+	float m_capturefps;
+	bool m_captureraw;
+	int32_t m_capturedecimation;
+	std::string m_cameracache;
+	std::string m_input;
+	std::string m_inputpacing;
+	float m_inputfps;
+	bool m_loopinput;
+	bool m_synthetic;
+	int32_t m_syntheticwidth;
+	int32_t m_syntheticheight;
+	float m_syntheticfps;
+	int32_t m_syntheticframes;
+	int32_t m_syntheticclip;
+	bool m_nogui;
 
 	std::string m_posemodel;
+	std::string m_posemodelfast;
+	float m_latencybudget;
+	float m_latencyhysteresis;
+	std::string m_modelcachedir;
+	bool m_sharemodelmapping;
+	int32_t m_intraopthreads;
+	int32_t m_interopthreads;
+	std::string m_executionmode;
+	bool m_threadspinning;
+	std::string m_threadaffinity;
+	bool m_globalthreadpool;
+	int32_t m_posesessions;
+	bool m_smartcrop;
+	float m_smartcropscore;
+	float m_motionthreshold;
+	int32_t m_motionmaxskip;
+	bool m_trackkeypoints;
+	int32_t m_trackwidth;
+	std::string m_posesubject;
+	std::string m_guimailbox;
+	std::string m_tcodemailbox;
+	int32_t m_mailboxsize;
 
 	int32_t m_posesamp;
 
 	// debug
+	bool m_posenormalizeoverride;
 	float m_posediv;
 	float m_poseadd;
 };
@@ -28,4 +70,7 @@ namespace global
 
 	void MultiByteToWideCharString(const std::string& mbstring, std::wstring& wcstring);
 
+	// 64 bit FNV-1a, pass the previous result as hash to continue hashing more data
+	uint64_t HashFNV1a(const void* data, const size_t size, const uint64_t hash = 14695981039346656037ULL);
+
 }	// namespace global
\ No newline at end of file
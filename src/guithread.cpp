@@ -1,6 +1,8 @@
 #include "guithread.h"
 
+#include <algorithm>
 #include <atomic>
+#include <string>
 #include <thread>
 #include <mutex>
 
@@ -32,6 +34,7 @@ void GUIThread::Run(const IThread::ThreadParameters* threadparameters)
 		m_stopcamera = params.m_stopcamera;
 		m_camerastatus = params.m_camerastatus;
 		m_setposetrackinglocation = params.m_setposetrackinglocation;
+		m_selectedcamera = params.m_camera;
 
 		std::thread ft([this,&params]() {
 
@@ -45,11 +48,6 @@ void GUIThread::Run(const IThread::ThreadParameters* threadparameters)
 
 					fm->GetButtonStartStop()->events().click(std::bind(&GUIThread::HandleButtonStartStopClick, this));
 					
-					// MUST set initial selection before setting combo box change event - otherwise event will fire
-					if (params.m_camera >= 0 && params.m_camera < fm->GetComboCamera()->the_number_of_options())
-					{
-						fm->GetComboCamera()->option(params.m_camera);
-					}
 					fm->GetComboCamera()->events().text_changed(std::bind(&GUIThread::HandleComboCameraChanged, this));
 					fm->GetComboTrack()->events().text_changed(std::bind(&GUIThread::HandleComboTrackChanged, this));
 
@@ -83,6 +81,8 @@ void GUIThread::Run(const IThread::ThreadParameters* threadparameters)
 		{
 			std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+			UpdateComboCamera();
+
 			// TODO - update camera status, pose status labels
 			if (m_camerastatus && m_form && m_formrunning)
 			{
@@ -137,15 +137,36 @@ void GUIThread::ReceivePose(const cv::Mat& inim, const PoseDetection& posedetect
 			}
 		}
 
-		cv::Mat im = inim.clone();
+		// nothing to draw on, don't spend time converting the frame
+		if (size == 0)
+		{
+			return;
+		}
+
+		cv::Mat im;
+		ConvertToBGR(inim, im);
+		bool found = false;
+		cv::Point top;
 		for (std::array<KeypointDetection, KeypointLocation::KEYPOINT_MAX>::const_iterator i = posedetection.m_keypoints.begin(); i != posedetection.m_keypoints.end(); i++)
 		{
 			if ((*i).m_presence == KeypointPresence::KEYPOINT_PRESENCE_PRESENT)
 			{
-				cv::circle(im, cv::Point((*i).m_pos.m_x, (*i).m_pos.m_y), 3, cv::Scalar(0.0, 255.0, 0.0), 1, 8, 0);
+				const cv::Point pos((*i).m_pos.m_x, (*i).m_pos.m_y);
+				cv::circle(im, pos, 3, cv::Scalar(0.0, 255.0, 0.0), 1, 8, 0);
+				if (!found || pos.y < top.y)
+				{
+					top = pos;
+					found = true;
+				}
 			}
 		}
 
+		// track id above the person, for picking one with --posesubject
+		if (found && posedetection.m_id >= 0)
+		{
+			cv::putText(im, std::to_string(posedetection.m_id), cv::Point(top.x, std::max(top.y - 10, 15)), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0.0, 255.0, 0.0), 2);
+		}
+
 		cv::Mat displayim;
 		if (size!=0 && ((im.rows != im.cols) || (im.rows != size)))
 		{
@@ -195,11 +216,69 @@ void GUIThread::HandleButtonStartStopClick()
 
 void GUIThread::HandleComboCameraChanged()
 {
-	if (m_setcamera)
+	if (!m_setcamera || m_updatingcameras)
 	{
-		m_setcamera(m_form.load()->GetComboCamera()->option());
-		std::cout << "Set camera " << m_form.load()->GetComboCamera()->option() << std::endl;
+		return;
+	}
+
+	int32_t camera = -1;
+	{
+		std::lock_guard<std::mutex> guard(m_formmutex);
+		const size_t option = m_form.load()->GetComboCamera()->option();
+		if (option < m_comboindexes.size())
+		{
+			camera = m_comboindexes[option];
+		}
+	}
+	if (camera >= 0)
+	{
+		m_selectedcamera = camera;
+		m_setcamera(camera);
+		std::cout << "Set camera " << camera << std::endl;
+	}
+}
+
+void GUIThread::ReceiveCameras(const std::vector<CameraInfo>& cameras)
+{
+	std::lock_guard<std::mutex> guard(m_cameramutex);
+	m_cameras = cameras;
+	m_camerasupdated = true;
+}
+
+void GUIThread::UpdateComboCamera()
+{
+	std::lock_guard<std::mutex> guard(m_formmutex);
+	if (!m_formcreated || !m_formrunning || !m_form)
+	{
+		return;		// try again once the form is up
+	}
+
+	std::vector<CameraInfo> cameras;
+	{
+		std::lock_guard<std::mutex> cameraguard(m_cameramutex);
+		if (!m_camerasupdated)
+		{
+			return;
+		}
+		cameras = m_cameras;
+		m_camerasupdated = false;
+	}
+
+	// refilling the combo box fires its change event, which mustn't switch cameras
+	m_updatingcameras = true;
+	nana::combox* combo = m_form.load()->GetComboCamera();
+	combo->clear();
+	m_comboindexes.clear();
+	for (std::vector<CameraInfo>::const_iterator i = cameras.begin(); i != cameras.end(); i++)
+	{
+		combo->push_back((*i).m_name);
+		m_comboindexes.push_back((*i).m_index);
+		if ((*i).m_index == m_selectedcamera)
+		{
+			combo->option(m_comboindexes.size() - 1);
+		}
 	}
+	m_updatingcameras = false;
 }
 
 void GUIThread::HandleComboTrackChanged()
@@ -6,6 +6,7 @@
 #include <atomic>
 
 #include "cameracapturethread.h"
+#include "cameraenumerationthread.h"
 #include "posekeypointdata.h"
 #include "tcodegenerator.h"
 #include "formmain.h"
@@ -36,6 +37,7 @@ public:
 
 	void ReceivePose(const cv::Mat& im, const PoseDetection& posedetection);
 	void ReceivePoseMovement(const PoseMovement& pm, const PoseTrackingLocation& track);
+	void ReceiveCameras(const std::vector<CameraInfo>& cameras);		// replaces the camera list, can be called from any thread
 
 private:
 
@@ -44,6 +46,7 @@ private:
 	void HandleButtonStartStopClick();
 	void HandleComboCameraChanged();
 	void HandleComboTrackChanged();
+	void UpdateComboCamera();
 
 	std::mutex m_formmutex;
 	std::atomic<bool> m_formcreated = false;
@@ -56,4 +59,11 @@ private:
 	std::function<CameraCaptureThread::CameraCaptureStatus()> m_camerastatus = nullptr;
 	std::function<void(const PoseTrackingLocation)> m_setposetrackinglocation = nullptr;
 
+	std::mutex m_cameramutex;
+	std::vector<CameraInfo> m_cameras;				// guarded by m_cameramutex, latest list received
+	bool m_camerasupdated = false;					// guarded by m_cameramutex, m_cameras isn't in the combo box yet
+	std::vector<int32_t> m_comboindexes;			// guarded by m_formmutex, camera index for each combo box option
+	std::atomic<int32_t> m_selectedcamera = -1;
+	std::atomic<bool> m_updatingcameras = false;	// combo box changes aren't from the user
+
 };
@@ -18,7 +18,7 @@ public:
 
 	void Start(const ThreadParameters* threadparameters);
 
-	void Stop();
+	virtual void Stop();
 	bool IsRunning() const;
 
 protected:
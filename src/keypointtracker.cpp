@@ -0,0 +1,184 @@
+#include "keypointtracker.h"
+
+#include <utility>
+#include <vector>
+
+#include "opencvfunctions.h"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+KeypointTracker::KeypointTracker() :m_maxwidth(320), m_history(16), m_haspose(false), m_posesequence(0)
+{
+
+}
+
+KeypointTracker::~KeypointTracker()
+{
+
+}
+
+void KeypointTracker::Configure(const int32_t maxwidth, const int32_t history)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_maxwidth = (maxwidth > 0) ? maxwidth : 320;
+	m_history = (history > 1) ? static_cast<size_t>(history) : 2;
+	m_frames.clear();
+	m_haspose = false;
+	m_posesequence = 0;
+}
+
+bool KeypointTracker::Track(const uint64_t sequence, const std::chrono::steady_clock::time_point timestamp, const cv::Mat& img, PoseDetection& posedetection)
+{
+	TrackedFrame frame;
+	frame.m_sequence = sequence;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		frame.m_pyramid.swap(m_sparepyramid);
+	}
+
+	// scale, convert and build the pyramid outside the lock so a pose model result being anchored doesn't wait on it
+	// the pyramid copies the gray image into its own bordered buffer, so the gray buffers are free again afterwards
+	const cv::Mat* gray = &m_gray;
+	if (IsYUYVImage(img))
+	{
+		// luma is already there, take it before scaling
+		cv::cvtColor(img, m_luma, cv::COLOR_YUV2GRAY_YUYV);
+		if (m_luma.cols > m_maxwidth)
+		{
+			cv::resize(m_luma, m_gray, cv::Size(m_maxwidth, (m_luma.rows * m_maxwidth) / m_luma.cols), 0, 0, cv::INTER_AREA);
+		}
+		else
+		{
+			gray = &m_luma;
+		}
+	}
+	else if (img.cols > m_maxwidth)
+	{
+		cv::resize(img, m_small, cv::Size(m_maxwidth, (img.rows * m_maxwidth) / img.cols), 0, 0, cv::INTER_AREA);
+		cv::cvtColor(m_small, m_gray, cv::COLOR_BGR2GRAY);
+	}
+	else
+	{
+		cv::cvtColor(img, m_gray, cv::COLOR_BGR2GRAY);
+	}
+	frame.m_scale = static_cast<float>(gray->cols) / static_cast<float>(img.cols);
+	cv::buildOpticalFlowPyramid(*gray, frame.m_pyramid, cv::Size(WINDOW_SIZE, WINDOW_SIZE), PYRAMID_LEVELS);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	// a change in frame size makes the older frames useless
+	if (!m_frames.empty() && m_frames.back().m_pyramid[0].size() != frame.m_pyramid[0].size())
+	{
+		m_frames.clear();
+		m_haspose = false;
+	}
+
+	const TrackedFrame* from = m_haspose ? FindFrame(m_posesequence) : nullptr;
+	if (from)
+	{
+		MoveKeypoints(*from, frame, m_pose);
+		m_posesequence = sequence;
+	}
+	else
+	{
+		m_haspose = false;		// the frame the pose was on is gone
+	}
+
+	m_frames.push_back(std::move(frame));
+	while (m_frames.size() > m_history)
+	{
+		m_sparepyramid.swap(m_frames.front().m_pyramid);
+		m_frames.pop_front();
+	}
+
+	if (m_haspose)
+	{
+		posedetection = m_pose;
+		posedetection.m_timestamp = timestamp;
+		posedetection.m_sequence = sequence;
+	}
+	return m_haspose;
+}
+
+void KeypointTracker::Anchor(const uint64_t sequence, const PoseDetection& posedetection)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	// frames can be skipped when tracking falls behind, if the model ran on one of those the frame before it is close enough
+	const TrackedFrame* from = FindFrameAtOrBefore(sequence);
+	if (!from || m_frames.empty())
+	{
+		return;		// too old to catch up with the frames tracked since
+	}
+
+	m_pose = posedetection;
+	m_posesequence = m_frames.back().m_sequence;
+	m_haspose = true;
+	if (from != &m_frames.back())
+	{
+		MoveKeypoints(*from, m_frames.back(), m_pose);
+	}
+}
+
+const KeypointTracker::TrackedFrame* KeypointTracker::FindFrame(const uint64_t sequence) const
+{
+	for (std::deque<TrackedFrame>::const_reverse_iterator i = m_frames.rbegin(); i != m_frames.rend(); i++)
+	{
+		if ((*i).m_sequence == sequence)
+		{
+			return &(*i);
+		}
+	}
+	return nullptr;
+}
+
+const KeypointTracker::TrackedFrame* KeypointTracker::FindFrameAtOrBefore(const uint64_t sequence) const
+{
+	for (std::deque<TrackedFrame>::const_reverse_iterator i = m_frames.rbegin(); i != m_frames.rend(); i++)
+	{
+		if ((*i).m_sequence <= sequence)
+		{
+			return &(*i);
+		}
+	}
+	return nullptr;
+}
+
+void KeypointTracker::MoveKeypoints(const TrackedFrame& from, const TrackedFrame& to, PoseDetection& posedetection) const
+{
+	// keypoints are in camera frame pixels, the tracked frames may be scaled down
+	std::vector<cv::Point2f> frompoints;
+	std::vector<size_t> keypoints;
+	for (size_t i = 0; i < posedetection.m_keypoints.size(); i++)
+	{
+		if (posedetection.m_keypoints[i].m_presence == KEYPOINT_PRESENCE_PRESENT)
+		{
+			frompoints.push_back(cv::Point2f(posedetection.m_keypoints[i].m_pos.m_x * from.m_scale, posedetection.m_keypoints[i].m_pos.m_y * from.m_scale));
+			keypoints.push_back(i);
+		}
+	}
+	if (frompoints.empty())
+	{
+		return;
+	}
+
+	std::vector<cv::Point2f> topoints;
+	std::vector<uint8_t> status;
+	std::vector<float> error;
+	cv::calcOpticalFlowPyrLK(from.m_pyramid, to.m_pyramid, frompoints, topoints, status, error, cv::Size(WINDOW_SIZE, WINDOW_SIZE), PYRAMID_LEVELS);
+
+	for (size_t i = 0; i < keypoints.size(); i++)
+	{
+		KeypointDetection& keypoint = posedetection.m_keypoints[keypoints[i]];
+		if (status[i])
+		{
+			keypoint.m_pos.m_x = topoints[i].x / to.m_scale;
+			keypoint.m_pos.m_y = topoints[i].y / to.m_scale;
+		}
+		else
+		{
+			keypoint.m_presence = KEYPOINT_PRESENCE_NOT_PRESENT;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "posekeypointdata.h"
+
+/*
+
+	Moves the keypoints of the last pose along with the image between pose model results using pyramidal Lucas-Kanade optical flow
+	Every camera frame goes through Track, which returns the pose moved onto that frame
+	A pose model result for an older frame replaces the tracked pose through Anchor, which moves it onto the newest tracked frame first
+
+	Frames are tracked in grayscale at reduced size, the last few are kept so results can be anchored to the frame they were detected on
+	Keypoints that can't be followed are marked not present until the next result
+
+	Track must always be called from the same thread, its grayscale images and the pyramid of the frame leaving the history are reused for the next frame
+
+*/
+
+class KeypointTracker
+{
+public:
+	KeypointTracker();
+	~KeypointTracker();
+
+	// frames are scaled down to at most maxwidth pixels wide for tracking
+	void Configure(const int32_t maxwidth, const int32_t history);
+
+	// returns false until there is a pose to track
+	bool Track(const uint64_t sequence, const std::chrono::steady_clock::time_point timestamp, const cv::Mat& img, PoseDetection& posedetection);
+	void Anchor(const uint64_t sequence, const PoseDetection& posedetection);
+
+private:
+
+	static constexpr int32_t WINDOW_SIZE = 15;		// patch around each keypoint, in tracked pixels
+	static constexpr int32_t PYRAMID_LEVELS = 2;
+
+	struct TrackedFrame
+	{
+		uint64_t m_sequence{ 0 };
+		float m_scale{ 1.0 };				// tracked pixels per camera frame pixel
+		std::vector<cv::Mat> m_pyramid;		// built once, used when tracking to and from this frame
+	};
+
+	const TrackedFrame* FindFrame(const uint64_t sequence) const;
+	const TrackedFrame* FindFrameAtOrBefore(const uint64_t sequence) const;
+	void MoveKeypoints(const TrackedFrame& from, const TrackedFrame& to, PoseDetection& posedetection) const;
+
+	int32_t m_maxwidth;
+	size_t m_history;
+
+	// only used by Track
+	cv::Mat m_luma;
+	cv::Mat m_small;
+	cv::Mat m_gray;
+
+	std::mutex m_mutex;
+	std::deque<TrackedFrame> m_frames;				// guarded by m_mutex, oldest first
+	bool m_haspose;									// guarded by m_mutex
+	uint64_t m_posesequence;						// guarded by m_mutex, frame m_pose is on
+	PoseDetection m_pose;							// guarded by m_mutex
+	std::vector<cv::Mat> m_sparepyramid;			// guarded by m_mutex, buffers of the last frame dropped from the history
+
+};
@@ -9,12 +9,18 @@
 
 #include <vector>
 #include <cstdint>
+#include <algorithm>
 
 #include "cameracapturethread.h"
+#include "cameraenumerationthread.h"
+#include "filecapturethread.h"
+#include "syntheticcapturethread.h"
 #include "posedetectorthread.h"
 #include "guithread.h"
 #include "tcodegenerator.h"
+#include "posebus.h"
 #include "restimtcpconnection.h"
+#include "preprocessbenchmark.h"
 
 std::vector <float> sigmoid(const std::vector <float>& m1) {
 
@@ -50,9 +56,32 @@ int main(int argc, char* argv[])
 	cxxopts::Options options("restimulator", "Restim Controller");
 	options.add_options()
 		("h,help", "Help", cxxopts::value<bool>(), "Print help")
-		("directml", "Use DirectML", cxxopts::value<bool>()->default_value("false"), "Use DirectML on GPU for running ONNX models")
+		("ep", "Execution Provider", cxxopts::value<std::string>()->default_value("cpu"), "ONNX Runtime execution provider for running ONNX models - cpu, xnnpack, openvino or dml")
+		("epoptions", "Execution Provider Options", cxxopts::value<std::string>()->default_value(""), "Execution provider options as key=value pairs separated by ; e.g. intra_op_num_threads=4 for xnnpack or device_type=CPU;num_of_threads=8 for openvino")
+		("directml", "Use DirectML", cxxopts::value<bool>()->default_value("false"), "Use DirectML on GPU for running ONNX models (same as --ep dml)")
 		("dmldevid", "DirectML Device ID", cxxopts::value<int>()->default_value("0"), "ID (Index) of GPU device to use for DirectML")
 		("camera", "Camera ID", cxxopts::value<int>()->default_value("0"), "ID (Index) of camera device to use for input")
+		("capturebackend", "Capture Backend", cxxopts::value<std::string>()->default_value("any"), "OpenCV camera backend - any, v4l2, gstreamer, ffmpeg, dshow or msmf")
+		("capturefourcc", "Capture FOURCC", cxxopts::value<std::string>()->default_value(""), "Camera pixel format to request e.g. MJPG or YUYV (empty = camera default)")
+		("capturewidth", "Capture Width", cxxopts::value<int>()->default_value("0"), "Camera frame width to request (0 = camera default)")
+		("captureheight", "Capture Height", cxxopts::value<int>()->default_value("0"), "Camera frame height to request (0 = camera default)")
+		("capturefps", "Capture FPS", cxxopts::value<float>()->default_value("0"), "Camera frame rate to request (0 = camera default)")
+		("captureraw", "Raw Capture", cxxopts::value<bool>()->default_value("false"), "Keep YUYV camera frames as YUYV and convert them straight into the pose model input instead of converting every frame to BGR. Needs a camera sending YUYV e.g. --capturefourcc YUYV")
+		("cameracache", "Camera Cache", cxxopts::value<std::string>()->default_value("cameras.txt"), "File the camera list is saved in so the next start can show it right away while the cameras are found again (disabled if empty)")
+		("probecameras", "Probe Cameras", cxxopts::value<bool>()->default_value("false"), "List the resolutions, pixel formats and frame rates each camera accepts with --capturebackend then exit")
+		("capturedecimation", "Capture Decimation", cxxopts::value<int>()->default_value("0"), "Decode only every nth camera frame (0 = decode a frame whenever the pose detector is ready for one)")
+		("input", "Input File", cxxopts::value<std::string>()->default_value(""), "Read frames from a video file or a directory of images instead of a camera. The program exits when the input ends unless --loopinput is set")
+		("inputpacing", "Input Pacing", cxxopts::value<std::string>()->default_value("realtime"), "How fast --input is read - realtime (at the file's own timing), fast (as fast as the pose detector takes frames) or fixed (at --inputfps)")
+		("inputfps", "Input FPS", cxxopts::value<float>()->default_value("0"), "Frame rate for --inputpacing fixed and for image directories (0 = the video's own rate or 30 for images)")
+		("loopinput", "Loop Input", cxxopts::value<bool>()->default_value("false"), "Start --input again from the beginning when it ends")
+		("synthetic", "Synthetic Input", cxxopts::value<bool>()->default_value("false"), "Feed the pose detector a drawn figure with known keypoints instead of a camera and print throughput, drop rate, latency and keypoint error every 5 seconds")
+		("syntheticwidth", "Synthetic Width", cxxopts::value<int>()->default_value("640"), "Width of --synthetic frames")
+		("syntheticheight", "Synthetic Height", cxxopts::value<int>()->default_value("480"), "Height of --synthetic frames")
+		("syntheticfps", "Synthetic FPS", cxxopts::value<float>()->default_value("30"), "Rate --synthetic frames are sent at (0 = as fast as the pose detector takes them)")
+		("syntheticframes", "Synthetic Frames", cxxopts::value<int>()->default_value("0"), "Exit after this many --synthetic frames (0 = run until stopped)")
+		("syntheticclip", "Synthetic Clip", cxxopts::value<int>()->default_value("60"), "Frames in the --synthetic movement loop, drawn before starting and copied out (0 = draw every frame as it is sent)")
+		("nogui", "No GUI", cxxopts::value<bool>()->default_value("false"), "Run without the window e.g. for --synthetic benchmarks on a machine without a display, the camera starts capturing right away")
+		("benchmarkpreprocess", "Benchmark Preprocessing", cxxopts::value<bool>()->default_value("false"), "Time the image preprocessing kernels at 192x192 and 256x256 then exit")
 		;
 
 	options.add_options("restim")
@@ -62,10 +91,32 @@ int main(int argc, char* argv[])
 
 	options.add_options("pose")
 		("posemodel", "Pose Model", cxxopts::value<std::string>()->default_value("movenet_lightning.onnx"), "Full or relative path to the pose detection ONNX model to use")
+		("intraopthreads", "Intra-op Threads", cxxopts::value<int>()->default_value("1"), "Number of threads ONNX Runtime uses inside an operator (0 = one per physical core)")
+		("interopthreads", "Inter-op Threads", cxxopts::value<int>()->default_value("0"), "Number of threads ONNX Runtime uses to run operators in parallel with --executionmode parallel (0 = default)")
+		("executionmode", "Execution Mode", cxxopts::value<std::string>()->default_value("sequential"), "ONNX Runtime graph execution mode - sequential or parallel")
+		("threadspinning", "Thread Spinning", cxxopts::value<bool>()->default_value("true"), "Let idle ONNX Runtime threads spin waiting for work (lower latency, higher CPU use). Use --threadspinning=false to disable")
+		("threadaffinity", "Thread Affinity", cxxopts::value<std::string>()->default_value(""), "ONNX Runtime intra-op thread affinity, one entry per thread after the first separated by ; e.g. 1;2;3 or 1,2;3,4")
+		("globalthreadpool", "Global Thread Pool", cxxopts::value<bool>()->default_value("false"), "Create one ONNX Runtime thread pool shared by all pose model sessions")
+		("modelcache", "Model Cache Directory", cxxopts::value<std::string>()->default_value(""), "Directory to save optimized pose models in so later starts can skip graph optimization (disabled if empty)")
+		("sharemodelmapping", "Share Model Mapping", cxxopts::value<bool>()->default_value("true"), "Pose model sessions loading the same model file share one memory mapping of it. Use --sharemodelmapping=false to map it once per session")
+		("posemodelfast", "Fast Pose Model", cxxopts::value<std::string>()->default_value(""), "Optional faster pose model loaded alongside --posemodel, used while --posemodel can't keep inference within --latencybudget")
+		("latencybudget", "Latency Budget", cxxopts::value<float>()->default_value("0"), "Pose inference time in ms (95th percentile) above which the detector switches to --posemodelfast (0 = never switch)")
+		("latencyhysteresis", "Latency Hysteresis", cxxopts::value<float>()->default_value("0.5"), "Switch back to --posemodel once the fast model's 95th percentile inference time is below this fraction of --latencybudget")
+		("posesessions", "Pose Sessions", cxxopts::value<int>()->default_value("1"), "Number of model sessions running inference on consecutive frames at the same time. Results are still delivered in capture order")
+		("smartcrop", "Smart Crop", cxxopts::value<bool>()->default_value("false"), "Run the pose model on a square around the last detected pose instead of the center of the frame, using the whole frame when no pose is found")
+		("smartcropscore", "Smart Crop Score", cxxopts::value<float>()->default_value("0.2"), "Minimum score of the shoulder and hip keypoints for a smart crop around them")
+		("motionthreshold", "Motion Threshold", cxxopts::value<float>()->default_value("0"), "Mean change in gray levels (0-255) of a downsampled frame below which the last pose is reused instead of running the pose model (0 = always run the model)")
+		("motionmaxskip", "Motion Max Skip", cxxopts::value<int>()->default_value("15"), "Most frames in a row that can reuse the last pose with --motionthreshold")
+		("trackkeypoints", "Track Keypoints", cxxopts::value<bool>()->default_value("false"), "Follow the keypoints with optical flow on every camera frame between pose model results, so movement is sent at the camera frame rate")
+		("trackwidth", "Track Width", cxxopts::value<int>()->default_value("320"), "Frames are scaled down to this width for --trackkeypoints")
+		("posesubject", "Pose Subject", cxxopts::value<std::string>()->default_value("largest"), "Person to follow when a multi pose model finds several - largest, center (closest to the center of the frame) or the track id of a person to stay locked on")
+		("guimailbox", "GUI Mailbox", cxxopts::value<std::string>()->default_value("latest"), "How poses queue up for the preview window when it falls behind - latest (only the newest pose is drawn) or dropoldest")
+		("tcodemailbox", "TCode Mailbox", cxxopts::value<std::string>()->default_value("dropoldest"), "How poses queue up for the TCode generator when it falls behind - latest or dropoldest")
+		("mailboxsize", "Mailbox Size", cxxopts::value<int>()->default_value("8"), "Number of poses a dropoldest mailbox holds before dropping the oldest")
 		("posesamp", "Pose Samples", cxxopts::value<int>()->default_value("3"), "Combine this many pose samples together to get an average value to smooth keypoint jitter")
 		// debug
-		("posediv", "Channel Divide", cxxopts::value<float>()->default_value("1.0"), "Value to divide image channel value for normalization")
-		("poseadd", "Channel Add", cxxopts::value<float>()->default_value("0"), "Value to add to image channel value after division for normalization")
+		("posediv", "Channel Divide", cxxopts::value<float>()->default_value("1.0"), "Value to divide image channel value for normalization (overrides the model's normalization)")
+		("poseadd", "Channel Add", cxxopts::value<float>()->default_value("0"), "Value to add to image channel value after division for normalization (overrides the model's normalization)")
 		;
 
 	cxxopts::ParseResult pr = options.parse(argc, argv);
@@ -76,16 +127,75 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
+	if (pr["probecameras"].as<bool>())
+	{
+		CaptureBackend backend = CAPTURE_BACKEND_ANY;
+		if (!GetCaptureBackend(pr["capturebackend"].as<std::string>(), backend))
+		{
+			std::cout << "Unknown capture backend " << pr["capturebackend"].as<std::string>() << std::endl;
+			return 1;
+		}
+		ProbeCameras(backend, 10);
+		return 0;
+	}
+
+	if (pr["benchmarkpreprocess"].as<bool>())
+	{
+		return RunPreprocessBenchmark(pr["posediv"].as<float>(), pr["poseadd"].as<float>()) ? 0 : 1;
+	}
+
 	ProgramOptions opts;
 
 	opts.m_restimhost = pr["restimhost"].as<std::string>();
 	opts.m_restimport = pr["restimport"].as<int>();
-	opts.m_directml = pr["directml"].as<bool>();
-	opts.m_dmldevid = pr["dmldevid"].as<int>();
+	opts.m_executionprovider = pr["directml"].as<bool>() ? ExecutionProviderName[EXECUTION_PROVIDER_DML] : pr["ep"].as<std::string>();
+	opts.m_executionprovideroptions = pr["epoptions"].as<std::string>();
 	opts.m_camera = pr["camera"].as<int>();
+	opts.m_capturebackend = pr["capturebackend"].as<std::string>();
+	opts.m_capturefourcc = pr["capturefourcc"].as<std::string>();
+	opts.m_capturewidth = pr["capturewidth"].as<int>();
+	opts.m_captureheight = pr["captureheight"].as<int>();
+	opts.m_capturefps = pr["capturefps"].as<float>();
+	opts.m_captureraw = pr["captureraw"].as<bool>();
+	opts.m_capturedecimation = pr["capturedecimation"].as<int>();
+	opts.m_cameracache = pr["cameracache"].as<std::string>();
+	opts.m_input = pr["input"].as<std::string>();
+	opts.m_inputpacing = pr["inputpacing"].as<std::string>();
+	opts.m_inputfps = pr["inputfps"].as<float>();
+	opts.m_loopinput = pr["loopinput"].as<bool>();
+	opts.m_synthetic = pr["synthetic"].as<bool>();
+	opts.m_syntheticwidth = pr["syntheticwidth"].as<int>();
+	opts.m_syntheticheight = pr["syntheticheight"].as<int>();
+	opts.m_syntheticfps = pr["syntheticfps"].as<float>();
+	opts.m_syntheticframes = pr["syntheticframes"].as<int>();
+	opts.m_syntheticclip = pr["syntheticclip"].as<int>();
+	opts.m_nogui = pr["nogui"].as<bool>();
 	opts.m_posemodel = pr["posemodel"].as<std::string>();
+	opts.m_posemodelfast = pr["posemodelfast"].as<std::string>();
+	opts.m_latencybudget = pr["latencybudget"].as<float>();
+	opts.m_latencyhysteresis = pr["latencyhysteresis"].as<float>();
+	opts.m_modelcachedir = pr["modelcache"].as<std::string>();
+	opts.m_sharemodelmapping = pr["sharemodelmapping"].as<bool>();
 	opts.m_posesamp = pr["posesamp"].as<int>();
+	opts.m_intraopthreads = pr["intraopthreads"].as<int>();
+	opts.m_interopthreads = pr["interopthreads"].as<int>();
+	opts.m_executionmode = pr["executionmode"].as<std::string>();
+	opts.m_threadspinning = pr["threadspinning"].as<bool>();
+	opts.m_threadaffinity = pr["threadaffinity"].as<std::string>();
+	opts.m_globalthreadpool = pr["globalthreadpool"].as<bool>();
+	opts.m_posesessions = pr["posesessions"].as<int>();
+	opts.m_smartcrop = pr["smartcrop"].as<bool>();
+	opts.m_smartcropscore = pr["smartcropscore"].as<float>();
+	opts.m_motionthreshold = pr["motionthreshold"].as<float>();
+	opts.m_motionmaxskip = pr["motionmaxskip"].as<int>();
+	opts.m_trackkeypoints = pr["trackkeypoints"].as<bool>();
+	opts.m_trackwidth = pr["trackwidth"].as<int>();
+	opts.m_posesubject = pr["posesubject"].as<std::string>();
+	opts.m_guimailbox = pr["guimailbox"].as<std::string>();
+	opts.m_tcodemailbox = pr["tcodemailbox"].as<std::string>();
+	opts.m_mailboxsize = pr["mailboxsize"].as<int>();
 	//debug
+	opts.m_posenormalizeoverride = (pr.count("posediv") > 0 || pr.count("poseadd") > 0);
 	opts.m_posediv = pr["posediv"].as<float>();
 	opts.m_poseadd = pr["poseadd"].as<float>();
 	//debug
@@ -95,25 +205,164 @@ int main(int argc, char* argv[])
 	}
 	*/
 
+	CameraEnumerationThread cet;
 	CameraCaptureThread cct;
+	FileCaptureThread fct;
+	SyntheticCaptureThread sct;
 	PoseDetectorThread pdt;
 	GUIThread guit;
 	TCodeGenerator tcgt;
 	RestimTCPConnection rtct;
+	PoseSubscriber<PoseFrame> guisub;
+	PoseSubscriber<PoseDetection> tcodesub;
 
 	CameraCaptureThread::CameraCaptureThreadParameters cctp;
 	cctp.m_camera = opts.m_camera;
+	cctp.m_framepool = pdt.GetFramePool();
 	cctp.m_sendframe = std::bind(&PoseDetectorThread::ReceiveFrame, &pdt, std::placeholders::_1);
+	cctp.m_wantframe = std::bind(&PoseDetectorThread::WantsFrame, &pdt);
+	cctp.m_decimation = opts.m_capturedecimation;
+	if (!GetCaptureBackend(opts.m_capturebackend, cctp.m_format.m_backend))
+	{
+		std::cout << "Unknown capture backend " << opts.m_capturebackend << std::endl;
+		return 1;
+	}
+	if (!opts.m_capturefourcc.empty() && opts.m_capturefourcc.size() != 4)
+	{
+		std::cout << "Capture FOURCC must be 4 characters e.g. MJPG" << std::endl;
+		return 1;
+	}
+	cctp.m_format.m_fourcc = opts.m_capturefourcc;
+	cctp.m_format.m_width = opts.m_capturewidth;
+	cctp.m_format.m_height = opts.m_captureheight;
+	cctp.m_format.m_fps = opts.m_capturefps;
+	cctp.m_format.m_raw = opts.m_captureraw;
+
+	FileCaptureThread::FileCaptureThreadParameters fctp;
+	fctp.m_path = opts.m_input;
+	fctp.m_framepool = pdt.GetFramePool();
+	fctp.m_sendframe = std::bind(&PoseDetectorThread::ReceiveFrame, &pdt, std::placeholders::_1);
+	fctp.m_framepending = std::bind(&PoseDetectorThread::FramePending, &pdt);
+	fctp.m_ready = std::bind(&PoseDetectorThread::Ready, &pdt);
+	fctp.m_idle = std::bind(&PoseDetectorThread::Idle, &pdt);
+	fctp.m_finished = []() { global::stop = true; };
+	fctp.m_fps = opts.m_inputfps;
+	fctp.m_loop = opts.m_loopinput;
+	if (!GetFilePacing(opts.m_inputpacing, fctp.m_pacing))
+	{
+		std::cout << "Input pacing must be realtime, fast or fixed" << std::endl;
+		return 1;
+	}
+
+	SyntheticCaptureThread::SyntheticCaptureThreadParameters sctp;
+	sctp.m_framepool = pdt.GetFramePool();
+	sctp.m_sendframe = std::bind(&PoseDetectorThread::ReceiveFrame, &pdt, std::placeholders::_1);
+	sctp.m_framepending = std::bind(&PoseDetectorThread::FramePending, &pdt);
+	sctp.m_ready = std::bind(&PoseDetectorThread::Ready, &pdt);
+	sctp.m_idle = std::bind(&PoseDetectorThread::Idle, &pdt);
+	sctp.m_finished = []() { global::stop = true; };
+	sctp.m_width = opts.m_syntheticwidth;
+	sctp.m_height = opts.m_syntheticheight;
+	sctp.m_fps = opts.m_syntheticfps;
+	sctp.m_frames = static_cast<uint64_t>(std::max(opts.m_syntheticframes, 0));
+	sctp.m_cliplength = opts.m_syntheticclip;
+	if (opts.m_synthetic && !opts.m_input.empty())
+	{
+		std::cout << "Only one of --input and --synthetic can be used" << std::endl;
+		return 1;
+	}
 
 	PoseDetectorThread::PoseDetectorThreadParameters pdtp;
 	pdtp.m_onnxmodel = opts.m_posemodel;
-	pdtp.m_usedirectml = opts.m_directml;
-	pdtp.m_directmldevid = opts.m_dmldevid;
+	pdtp.m_onnxmodelfast = opts.m_posemodelfast;
+	pdtp.m_latencybudget = opts.m_latencybudget;
+	pdtp.m_latencyhysteresis = opts.m_latencyhysteresis;
+	pdtp.m_modelcachedir = opts.m_modelcachedir;
+	pdtp.m_sharemodelmapping = opts.m_sharemodelmapping;
+	if (!GetExecutionProvider(opts.m_executionprovider, pdtp.m_executionprovider))
+	{
+		std::cout << "Unknown execution provider " << opts.m_executionprovider << std::endl;
+		return 1;
+	}
+	if (!ParseExecutionProviderOptions(opts.m_executionprovideroptions, pdtp.m_executionprovideroptions))
+	{
+		std::cout << "Execution provider options must be key=value pairs separated by ;" << std::endl;
+		return 1;
+	}
+	if (pdtp.m_executionprovider == EXECUTION_PROVIDER_DML && pdtp.m_executionprovideroptions.find("device_id") == pdtp.m_executionprovideroptions.end())
+	{
+		pdtp.m_executionprovideroptions["device_id"] = std::to_string(pr["dmldevid"].as<int>());
+	}
+	pdtp.m_intraopthreads = opts.m_intraopthreads;
+	pdtp.m_interopthreads = opts.m_interopthreads;
+	if (opts.m_executionmode != "sequential" && opts.m_executionmode != "parallel")
+	{
+		std::cout << "Execution mode must be sequential or parallel" << std::endl;
+		return 1;
+	}
+	pdtp.m_parallelexecution = (opts.m_executionmode == "parallel");
+	pdtp.m_threadspinning = opts.m_threadspinning;
+	if (pdtp.m_executionprovider == EXECUTION_PROVIDER_XNNPACK && pdtp.m_threadspinning && pr.count("threadspinning") == 0)
+	{
+		// XNNPACK runs its own thread pool, ORT recommends not letting its threads spin alongside it unless asked to
+		std::cout << "Thread spinning is off with XNNPACK, use --threadspinning=true to turn it on" << std::endl;
+		pdtp.m_threadspinning = false;
+	}
+	pdtp.m_threadaffinity = opts.m_threadaffinity;
+	pdtp.m_globalthreadpool = opts.m_globalthreadpool;
+	pdtp.m_sessions = opts.m_posesessions;
+	pdtp.m_smartcrop = opts.m_smartcrop;
+	pdtp.m_smartcropscore = opts.m_smartcropscore;
+	pdtp.m_motionthreshold = opts.m_motionthreshold;
+	pdtp.m_motionmaxskip = opts.m_motionmaxskip;
+	pdtp.m_trackkeypoints = opts.m_trackkeypoints;
+	pdtp.m_trackwidth = opts.m_trackwidth;
+	if (!GetPoseSubject(opts.m_posesubject, pdtp.m_posesubject, pdtp.m_posesubjectid))
+	{
+		std::cout << "Pose subject must be largest, center or a track id" << std::endl;
+		return 1;
+	}
 	//debug
+	pdtp.m_posenormalizeoverride = opts.m_posenormalizeoverride;
 	pdtp.m_posediv = opts.m_posediv;
 	pdtp.m_poseadd = opts.m_poseadd;
-	pdtp.m_sendpose.push_back(std::bind(&GUIThread::ReceivePose, &guit, std::placeholders::_1, std::placeholders::_2));
-	pdtp.m_senddetection.push_back(std::bind(&TCodeGenerator::ReceivePose, &tcgt, std::placeholders::_1));
+	if (opts.m_synthetic)
+	{
+		pdtp.m_frametaken.push_back(std::bind(&SyntheticCaptureThread::FrameTaken, &sct));
+	}
+	else if (!opts.m_input.empty())
+	{
+		pdtp.m_frametaken.push_back(std::bind(&FileCaptureThread::FrameTaken, &fct));
+	}
+	if (!opts.m_nogui)
+	{
+		pdtp.m_sendpose.push_back([&guisub](const cv::Mat& im, const PoseDetection& posedetection) { guisub.Publish(PoseFrame(im, posedetection)); });
+	}
+	pdtp.m_senddetection.push_back(std::bind(&PoseSubscriber<PoseDetection>::Publish, &tcodesub, std::placeholders::_1));
+	if (opts.m_synthetic)
+	{
+		pdtp.m_senddetection.push_back(std::bind(&SyntheticCaptureThread::ReceivePose, &sct, std::placeholders::_1));
+	}
+
+	// consumers each run on their own thread behind a mailbox so they can't hold up the detector or each other
+	PoseSubscriber<PoseFrame>::PoseSubscriberParameters guisubp;
+	guisubp.m_name = "gui";
+	guisubp.m_capacity = opts.m_mailboxsize;
+	guisubp.m_receive = [&guit](const PoseFrame& pf) { guit.ReceivePose(pf.m_frame, pf.m_posedetection); };
+	PoseSubscriber<PoseDetection>::PoseSubscriberParameters tcodesubp;
+	tcodesubp.m_name = "tcode";
+	tcodesubp.m_capacity = opts.m_mailboxsize;
+	tcodesubp.m_receive = std::bind(&TCodeGenerator::ReceivePose, &tcgt, std::placeholders::_1);
+	if (!GetMailboxPolicy(opts.m_guimailbox, guisubp.m_policy) || !GetMailboxPolicy(opts.m_tcodemailbox, tcodesubp.m_policy))
+	{
+		std::cout << "Mailbox must be latest or dropoldest" << std::endl;
+		return 1;
+	}
+
+	CameraEnumerationThread::CameraEnumerationThreadParameters cetp;
+	cetp.m_sendcameras = std::bind(&GUIThread::ReceiveCameras, &guit, std::placeholders::_1);
+	cetp.m_cachefile = opts.m_cameracache;
+	cetp.m_backend = cctp.m_format.m_backend;
 
 	GUIThread::GUIThreadParameters guitp;
 	guitp.m_camera = opts.m_camera;
@@ -132,9 +381,34 @@ int main(int argc, char* argv[])
 	rtctp.m_host = opts.m_restimhost;
 	rtctp.m_port = opts.m_restimport;
 
-	cct.Start(&cctp);
+	if (!opts.m_nogui)
+	{
+		cet.Start(&cetp);
+		guisub.Start(&guisubp);
+	}
+	tcodesub.Start(&tcodesubp);
+	if (opts.m_synthetic)
+	{
+		sct.Start(&sctp);
+	}
+	else if (!opts.m_input.empty())
+	{
+		fct.Start(&fctp);
+	}
+	else
+	{
+		// the GUI's start button starts the camera, without it capture starts right away
+		if (opts.m_nogui)
+		{
+			cct.StartCapture();
+		}
+		cct.Start(&cctp);
+	}
 	pdt.Start(&pdtp);
-	guit.Start(&guitp);
+	if (!opts.m_nogui)
+	{
+		guit.Start(&guitp);
+	}
 	tcgt.Start(&tcgtp);
 	rtct.Start(&rtctp);
 
@@ -146,12 +420,17 @@ int main(int argc, char* argv[])
 
 	std::cout << "Stopping" << std::endl;
 
+	cet.Stop();
 	pdt.Stop();
 	cct.Stop();
+	fct.Stop();
+	sct.Stop();
+	guisub.Stop();
+	tcodesub.Stop();
 	guit.Stop();
 	tcgt.Stop();
 
-	while (pdt.IsRunning() || cct.IsRunning() || guit.IsRunning() /* || tcgt.IsRunning() || rtct.IsRunning()*/)
+	while (cet.IsRunning() || pdt.IsRunning() || cct.IsRunning() || fct.IsRunning() || sct.IsRunning() || guisub.IsRunning() || tcodesub.IsRunning() || guit.IsRunning() /* || tcgt.IsRunning() || rtct.IsRunning()*/)
 	{
 		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	}
@@ -0,0 +1,112 @@
+#include "mappedfile.h"
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) :m_path(path), m_data(nullptr), m_size(0)
+#ifdef _WIN32
+	, m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#endif
+{
+#ifdef _WIN32
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size;
+	if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_file);
+		}
+		throw std::runtime_error("Could not open " + path);
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	m_data = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!m_data)
+	{
+		if (m_mapping)
+		{
+			CloseHandle(m_mapping);
+		}
+		CloseHandle(m_file);
+		throw std::runtime_error("Could not map " + path);
+	}
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		throw std::runtime_error("Could not open " + path);
+	}
+	m_size = static_cast<size_t>(st.st_size);
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);		// the mapping keeps its own reference to the file
+	if (data == MAP_FAILED)
+	{
+		throw std::runtime_error("Could not map " + path);
+	}
+	m_data = data;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+#else
+	munmap(m_data, m_size);
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path, const bool share)
+{
+	if (!share)
+	{
+		return std::make_shared<MappedFile>(path);
+	}
+
+	static std::mutex sharedmutex;
+	static std::map<std::string, std::weak_ptr<MappedFile>> shared;
+
+	std::lock_guard<std::mutex> guard(sharedmutex);
+	std::shared_ptr<MappedFile> file = shared[path].lock();
+	if (!file)
+	{
+		file = std::make_shared<MappedFile>(path);
+		shared[path] = file;
+	}
+	return file;
+}
+
+const void* MappedFile::Data() const
+{
+	return m_data;
+}
+
+size_t MappedFile::Size() const
+{
+	return m_size;
+}
+
+const std::string& MappedFile::Path() const
+{
+	return m_path;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/*
+
+	Read only memory mapping of a whole file
+
+*/
+
+class MappedFile
+{
+public:
+	MappedFile(const std::string& path);		// throws if the file can't be mapped
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// with share the same mapping is returned for every open of a path while any user still holds it
+	static std::shared_ptr<MappedFile> Open(const std::string& path, const bool share);
+
+	const void* Data() const;
+	size_t Size() const;
+	const std::string& Path() const;
+
+private:
+
+	std::string m_path;
+	void* m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+
+};
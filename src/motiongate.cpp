@@ -0,0 +1,108 @@
+#include "motiongate.h"
+
+#include <cstdlib>
+
+MotionGate::MotionGate() :m_threshold(0), m_maxskip(0), m_hasreference(false), m_reference(), m_skipcount(0), m_skipped(0)
+{
+
+}
+
+MotionGate::~MotionGate()
+{
+
+}
+
+void MotionGate::Configure(const float threshold, const int32_t maxskip)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_threshold = threshold;
+	m_maxskip = maxskip;
+	m_hasreference = false;
+	m_skipcount = 0;
+	m_skipped = 0;
+}
+
+bool MotionGate::Enabled() const
+{
+	return m_threshold > 0;
+}
+
+bool MotionGate::Changed(const cv::Mat& img)
+{
+	if (!Enabled())
+	{
+		return true;
+	}
+
+	Thumbnail thumbnail;
+	MakeThumbnail(img, thumbnail);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	bool changed = !m_hasreference || m_skipcount >= m_maxskip;
+	if (!changed)
+	{
+		int32_t diff = 0;
+		for (size_t i = 0; i < thumbnail.size(); i++)
+		{
+			diff += std::abs(static_cast<int32_t>(thumbnail[i]) - static_cast<int32_t>(m_reference[i]));
+		}
+		changed = (static_cast<float>(diff) / static_cast<float>(thumbnail.size())) >= m_threshold;
+	}
+
+	if (changed)
+	{
+		m_reference = thumbnail;
+		m_hasreference = true;
+		m_skipcount = 0;
+	}
+	else
+	{
+		m_skipcount++;
+		m_skipped++;
+	}
+
+	return changed;
+}
+
+uint64_t MotionGate::Skipped() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_skipped;
+}
+
+void MotionGate::MakeThumbnail(const cv::Mat& img, Thumbnail& thumbnail)
+{
+	thumbnail.fill(0);
+	if (img.empty() || (img.channels() != 3 && img.channels() != 2) || img.cols < THUMBNAIL_WIDTH || img.rows < THUMBNAIL_HEIGHT)
+	{
+		return;
+	}
+
+	// each thumbnail pixel averages a 4 x 4 grid of samples spread over its block, enough to smooth out sensor noise without touching every pixel
+	const int32_t blockw = img.cols / THUMBNAIL_WIDTH;
+	const int32_t blockh = img.rows / THUMBNAIL_HEIGHT;
+	const int32_t stepx = (blockw >= 4) ? blockw / 4 : 1;
+	const int32_t stepy = (blockh >= 4) ? blockh / 4 : 1;
+	const int32_t samplesx = (blockw >= 4) ? 4 : blockw;
+	const int32_t samplesy = (blockh >= 4) ? 4 : blockh;
+	const int32_t pixelsize = img.channels();		// YUYV frames already have luma in the first byte of each pixel
+
+	for (int32_t ty = 0; ty < THUMBNAIL_HEIGHT; ty++)
+	{
+		for (int32_t tx = 0; tx < THUMBNAIL_WIDTH; tx++)
+		{
+			int32_t sum = 0;
+			for (int32_t sy = 0; sy < samplesy; sy++)
+			{
+				const uint8_t* row = img.ptr<uint8_t>((ty * blockh) + (sy * stepy));
+				for (int32_t sx = 0; sx < samplesx; sx++)
+				{
+					const uint8_t* px = row + (((tx * blockw) + (sx * stepx)) * pixelsize);
+					sum += (pixelsize == 2) ? px[0] * 4 : px[0] + (px[1] * 2) + px[2];		// rough luma, green weighted
+				}
+			}
+			thumbnail[(ty * THUMBNAIL_WIDTH) + tx] = static_cast<uint8_t>(sum / (samplesx * samplesy * 4));
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+#include <opencv2/core/mat.hpp>
+
+/*
+
+	Decides whether a frame changed enough since the last frame the pose model ran on to be worth running the model again
+	Frames are reduced to a small grayscale thumbnail and compared by mean absolute difference
+
+*/
+
+class MotionGate
+{
+public:
+	MotionGate();
+	~MotionGate();
+
+	// threshold is the mean difference in gray levels (0 - 255) that counts as motion, 0 disables the gate
+	// after maxskip frames in a row without motion the next frame runs anyway
+	void Configure(const float threshold, const int32_t maxskip);
+	bool Enabled() const;
+
+	// returns true if the frame should go through the model, it then becomes the frame later ones are compared against
+	bool Changed(const cv::Mat& img);
+
+	uint64_t Skipped() const;					// frames that didn't change since Configure
+
+	static constexpr int32_t THUMBNAIL_WIDTH = 32;
+	static constexpr int32_t THUMBNAIL_HEIGHT = 24;
+
+private:
+
+	typedef std::array<uint8_t, THUMBNAIL_WIDTH * THUMBNAIL_HEIGHT> Thumbnail;
+
+	static void MakeThumbnail(const cv::Mat& img, Thumbnail& thumbnail);
+
+	float m_threshold;
+	int32_t m_maxskip;
+
+	mutable std::mutex m_mutex;
+	bool m_hasreference;						// guarded by m_mutex
+	Thumbnail m_reference;						// guarded by m_mutex
+	int32_t m_skipcount;						// guarded by m_mutex, frames skipped since the reference
+	uint64_t m_skipped;							// guarded by m_mutex
+
+};
@@ -0,0 +1,424 @@
+#include "onnxquantization.h"
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+	/*
+
+		Minimal protobuf wire format reader, only what's needed to walk ModelProto -> GraphProto -> NodeProto / TensorProto
+
+		ModelProto		7 graph
+		GraphProto		1 node, 5 initializer
+		NodeProto		1 input, 2 output, 4 op_type, 5 attribute
+		AttributeProto	1 name, 5 t
+		TensorProto		1 dims, 2 data_type, 4 float_data, 5 int32_data, 8 name, 9 raw_data
+
+	*/
+
+	enum WireType
+	{
+		WIRE_TYPE_VARINT = 0,
+		WIRE_TYPE_FIXED64 = 1,
+		WIRE_TYPE_LENGTH = 2,
+		WIRE_TYPE_FIXED32 = 5
+	};
+
+	// TensorProto.DataType values we read
+	enum TensorDataType
+	{
+		TENSOR_DATA_TYPE_FLOAT = 1,
+		TENSOR_DATA_TYPE_UINT8 = 2,
+		TENSOR_DATA_TYPE_INT8 = 3,
+		TENSOR_DATA_TYPE_INT32 = 6
+	};
+
+	struct ProtoField
+	{
+		uint32_t m_number{ 0 };
+		uint32_t m_wiretype{ 0 };
+		uint64_t m_value{ 0 };				// varint and fixed values
+		const uint8_t* m_data{ nullptr };	// length delimited values
+		size_t m_size{ 0 };
+
+		std::string String() const
+		{
+			return std::string(reinterpret_cast<const char*>(m_data), m_size);
+		}
+	};
+
+	class ProtoReader
+	{
+	public:
+		ProtoReader(const uint8_t* data, const size_t size) :m_pos(data), m_end(data + size)
+		{
+
+		}
+
+		bool AtEnd() const
+		{
+			return m_pos >= m_end;
+		}
+
+		uint64_t ReadVarint()
+		{
+			uint64_t value = 0;
+			for (int32_t shift = 0; shift < 64; shift += 7)
+			{
+				if (m_pos >= m_end)
+				{
+					throw std::runtime_error("ONNX model is truncated");
+				}
+				const uint8_t byte = *m_pos++;
+				value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+				{
+					return value;
+				}
+			}
+			throw std::runtime_error("ONNX model has a malformed varint");
+		}
+
+		// false at the end of the message
+		bool Next(ProtoField& field)
+		{
+			if (AtEnd())
+			{
+				return false;
+			}
+
+			const uint64_t key = ReadVarint();
+			field.m_number = static_cast<uint32_t>(key >> 3);
+			field.m_wiretype = static_cast<uint32_t>(key & 7);
+			field.m_value = 0;
+			field.m_data = nullptr;
+			field.m_size = 0;
+
+			switch (field.m_wiretype)
+			{
+			case WIRE_TYPE_VARINT:
+				field.m_value = ReadVarint();
+				break;
+			case WIRE_TYPE_FIXED64:
+				field.m_value = ReadFixed(8);
+				break;
+			case WIRE_TYPE_FIXED32:
+				field.m_value = ReadFixed(4);
+				break;
+			case WIRE_TYPE_LENGTH:
+			{
+				const uint64_t size = ReadVarint();
+				if (size > static_cast<uint64_t>(m_end - m_pos))
+				{
+					throw std::runtime_error("ONNX model is truncated");
+				}
+				field.m_data = m_pos;
+				field.m_size = static_cast<size_t>(size);
+				m_pos += size;
+				break;
+			}
+			default:
+				throw std::runtime_error("ONNX model has an unsupported protobuf wire type");
+			}
+			return true;
+		}
+
+	private:
+
+		uint64_t ReadFixed(const size_t bytes)
+		{
+			if (bytes > static_cast<size_t>(m_end - m_pos))
+			{
+				throw std::runtime_error("ONNX model is truncated");
+			}
+			uint64_t value = 0;
+			for (size_t i = 0; i < bytes; i++)
+			{
+				value |= static_cast<uint64_t>(m_pos[i]) << (i * 8);
+			}
+			m_pos += bytes;
+			return value;
+		}
+
+		const uint8_t* m_pos;
+		const uint8_t* m_end;
+	};
+
+	float FloatFromBits(const uint32_t bits)
+	{
+		float value = 0;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// the single value of a scalar or one element tensor, false for anything bigger or of another type
+	bool ReadScalar(const ProtoField& tensor, double& value)
+	{
+		int64_t count = 1;
+		uint64_t datatype = 0;
+		std::vector<double> values;
+		const uint8_t* raw = nullptr;
+		size_t rawsize = 0;
+
+		ProtoReader reader(tensor.m_data, tensor.m_size);
+		ProtoField field;
+		while (reader.Next(field))
+		{
+			if (field.m_number == 1)
+			{
+				if (field.m_wiretype == WIRE_TYPE_LENGTH)
+				{
+					ProtoReader dims(field.m_data, field.m_size);
+					while (!dims.AtEnd())
+					{
+						count *= static_cast<int64_t>(dims.ReadVarint());
+					}
+				}
+				else
+				{
+					count *= static_cast<int64_t>(field.m_value);
+				}
+			}
+			else if (field.m_number == 2)
+			{
+				datatype = field.m_value;
+			}
+			else if (field.m_number == 4)
+			{
+				if (field.m_wiretype == WIRE_TYPE_LENGTH)
+				{
+					for (size_t i = 0; i + 4 <= field.m_size; i += 4)
+					{
+						uint32_t bits = 0;
+						std::memcpy(&bits, field.m_data + i, sizeof(bits));
+						values.push_back(FloatFromBits(bits));
+					}
+				}
+				else
+				{
+					values.push_back(FloatFromBits(static_cast<uint32_t>(field.m_value)));
+				}
+			}
+			else if (field.m_number == 5)
+			{
+				if (field.m_wiretype == WIRE_TYPE_LENGTH)
+				{
+					ProtoReader packed(field.m_data, field.m_size);
+					while (!packed.AtEnd())
+					{
+						values.push_back(static_cast<double>(static_cast<int32_t>(packed.ReadVarint())));
+					}
+				}
+				else
+				{
+					values.push_back(static_cast<double>(static_cast<int32_t>(field.m_value)));
+				}
+			}
+			else if (field.m_number == 9)
+			{
+				raw = field.m_data;
+				rawsize = field.m_size;
+			}
+		}
+
+		if (count != 1)
+		{
+			return false;
+		}
+
+		if (raw != nullptr)
+		{
+			switch (datatype)
+			{
+			case TENSOR_DATA_TYPE_FLOAT:
+				if (rawsize == 4)
+				{
+					uint32_t bits = 0;
+					std::memcpy(&bits, raw, sizeof(bits));
+					value = FloatFromBits(bits);
+					return true;
+				}
+				break;
+			case TENSOR_DATA_TYPE_UINT8:
+				if (rawsize == 1)
+				{
+					value = raw[0];
+					return true;
+				}
+				break;
+			case TENSOR_DATA_TYPE_INT8:
+				if (rawsize == 1)
+				{
+					value = static_cast<int8_t>(raw[0]);
+					return true;
+				}
+				break;
+			case TENSOR_DATA_TYPE_INT32:
+				if (rawsize == 4)
+				{
+					int32_t v = 0;
+					std::memcpy(&v, raw, sizeof(v));
+					value = v;
+					return true;
+				}
+				break;
+			default:
+				break;
+			}
+			return false;
+		}
+
+		if (values.size() == 1)
+		{
+			value = values[0];
+			return true;
+		}
+		return false;
+	}
+
+}
+
+bool FindInputQuantization(const void* data, const size_t size, const std::string& input, float& scale, int32_t& zeropoint)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	// ORT format models are flatbuffers with this identifier
+	if (size >= 8 && std::memcmp(bytes + 4, "ORTM", 4) == 0)
+	{
+		return false;
+	}
+
+	ProtoField graph;
+	ProtoField field;
+	ProtoReader model(bytes, size);
+	while (model.Next(field))
+	{
+		if (field.m_number == 7 && field.m_wiretype == WIRE_TYPE_LENGTH)
+		{
+			graph = field;
+		}
+	}
+	if (graph.m_data == nullptr)
+	{
+		return false;
+	}
+
+	// constant tensors by name, and the inputs of the DequantizeLinear reading our input
+	std::map<std::string, ProtoField> constants;
+	std::vector<std::string> dequantizeinputs;
+
+	ProtoReader graphreader(graph.m_data, graph.m_size);
+	while (graphreader.Next(field))
+	{
+		if (field.m_wiretype != WIRE_TYPE_LENGTH)
+		{
+			continue;
+		}
+
+		if (field.m_number == 5)
+		{
+			ProtoReader tensor(field.m_data, field.m_size);
+			ProtoField tensorfield;
+			while (tensor.Next(tensorfield))
+			{
+				if (tensorfield.m_number == 8 && tensorfield.m_wiretype == WIRE_TYPE_LENGTH)
+				{
+					constants[tensorfield.String()] = field;
+				}
+			}
+		}
+		else if (field.m_number == 1)
+		{
+			std::vector<std::string> inputs;
+			std::vector<std::string> outputs;
+			std::string optype;
+			ProtoField value;
+
+			ProtoReader node(field.m_data, field.m_size);
+			ProtoField nodefield;
+			while (node.Next(nodefield))
+			{
+				if (nodefield.m_wiretype != WIRE_TYPE_LENGTH)
+				{
+					continue;
+				}
+
+				if (nodefield.m_number == 1)
+				{
+					inputs.push_back(nodefield.String());
+				}
+				else if (nodefield.m_number == 2)
+				{
+					outputs.push_back(nodefield.String());
+				}
+				else if (nodefield.m_number == 4)
+				{
+					optype = nodefield.String();
+				}
+				else if (nodefield.m_number == 5)
+				{
+					// a Constant node's value attribute
+					std::string name;
+					ProtoField tensor;
+					ProtoReader attribute(nodefield.m_data, nodefield.m_size);
+					ProtoField attributefield;
+					while (attribute.Next(attributefield))
+					{
+						if (attributefield.m_number == 1 && attributefield.m_wiretype == WIRE_TYPE_LENGTH)
+						{
+							name = attributefield.String();
+						}
+						else if (attributefield.m_number == 5 && attributefield.m_wiretype == WIRE_TYPE_LENGTH)
+						{
+							tensor = attributefield;
+						}
+					}
+					if (name == "value" && tensor.m_data != nullptr)
+					{
+						value = tensor;
+					}
+				}
+			}
+
+			if (optype == "Constant" && outputs.size() == 1 && value.m_data != nullptr)
+			{
+				constants[outputs[0]] = value;
+			}
+			else if (optype == "DequantizeLinear" && inputs.size() >= 2 && inputs[0] == input && dequantizeinputs.empty())
+			{
+				dequantizeinputs = inputs;
+			}
+		}
+	}
+
+	if (dequantizeinputs.empty())
+	{
+		return false;
+	}
+
+	double value = 0;
+	std::map<std::string, ProtoField>::const_iterator scaletensor = constants.find(dequantizeinputs[1]);
+	if (scaletensor == constants.end() || !ReadScalar((*scaletensor).second, value))
+	{
+		return false;
+	}
+	scale = static_cast<float>(value);
+
+	// the zero point is optional and defaults to 0
+	zeropoint = 0;
+	if (dequantizeinputs.size() >= 3 && !dequantizeinputs[2].empty())
+	{
+		std::map<std::string, ProtoField>::const_iterator zeropointtensor = constants.find(dequantizeinputs[2]);
+		if (zeropointtensor == constants.end() || !ReadScalar((*zeropointtensor).second, value))
+		{
+			return false;
+		}
+		zeropoint = static_cast<int32_t>(value);
+	}
+
+	return scale > 0.0f;
+}
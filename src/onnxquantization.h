@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+
+	Reads the quantization of a model input straight from the ONNX protobuf, ORT doesn't expose it
+	Quantized inputs are followed by a DequantizeLinear node, real = (q - zeropoint) * scale, whose scale and zero point are initializers or Constant nodes
+
+*/
+
+// false if the input isn't consumed by a per tensor DequantizeLinear, or the data isn't an ONNX model (ORT format models can't be read), throws on a malformed model
+bool FindInputQuantization(const void* data, const size_t size, const std::string& input, float& scale, int32_t& zeropoint);
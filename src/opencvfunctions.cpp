@@ -2,6 +2,23 @@
 
 #include <opencv2/imgproc.hpp>
 
+bool IsYUYVImage(const cv::Mat& img)
+{
+	return img.type() == CV_8UC2;
+}
+
+void ConvertToBGR(const cv::Mat& inimg, cv::Mat& outimg)
+{
+	if (IsYUYVImage(inimg))
+	{
+		cv::cvtColor(inimg, outimg, cv::COLOR_YUV2BGR_YUYV);
+	}
+	else
+	{
+		inimg.copyTo(outimg);
+	}
+}
+
 void ResizeCropImage(const cv::Mat& inimg, cv::Mat& outimg, const int32_t size, int32_t& offsetx, int32_t& offsety, float& scale)
 {
 	if (inimg.empty() || size < 1)
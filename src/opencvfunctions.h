@@ -4,4 +4,10 @@
 
 #include <opencv2/core/mat.hpp>
 
+// camera frames are BGR, or YUYV (2 channels, each pair of pixels sharing U and V) with raw capture
+bool IsYUYVImage(const cv::Mat& img);
+
+// YUYV is converted, BGR is copied
+void ConvertToBGR(const cv::Mat& inimg, cv::Mat& outimg);
+
 void ResizeCropImage(const cv::Mat& inimg, cv::Mat& outimg, const int32_t size, int32_t& offsetx, int32_t& offsety, float& scale);
@@ -0,0 +1,41 @@
+#include "posebus.h"
+
+std::array<std::string, MailboxPolicy::MAILBOX_POLICY_MAX> MailboxPolicyName{ "latest","dropoldest" };
+
+bool GetMailboxPolicy(const std::string& name, MailboxPolicy& policy)
+{
+	for (size_t i = 0; i < MailboxPolicyName.size(); i++)
+	{
+		if (name == MailboxPolicyName[i])
+		{
+			policy = static_cast<MailboxPolicy>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+PoseFrame::PoseFrame()
+{
+
+}
+
+PoseFrame::PoseFrame(const cv::Mat& frame, const PoseDetection& posedetection) :m_frame(frame), m_posedetection(posedetection)
+{
+
+}
+
+PoseFrame::PoseFrame(const PoseFrame& rhs) :m_frame(rhs.m_frame.clone()), m_posedetection(rhs.m_posedetection)
+{
+
+}
+
+PoseFrame& PoseFrame::operator=(const PoseFrame& rhs)
+{
+	if (this != &rhs)
+	{
+		rhs.m_frame.copyTo(m_frame);
+		m_posedetection = rhs.m_posedetection;
+	}
+	return *this;
+}
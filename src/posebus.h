@@ -0,0 +1,221 @@
+#pragma once
+
+#include "ithread.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "posekeypointdata.h"
+
+#include <opencv2/core/mat.hpp>
+
+enum MailboxPolicy
+{
+	MAILBOX_POLICY_LATEST = 0,			// only the newest message is kept
+	MAILBOX_POLICY_DROP_OLDEST,			// up to capacity messages are queued, a full mailbox drops its oldest message
+	MAILBOX_POLICY_MAX
+};
+
+extern std::array<std::string, MailboxPolicy::MAILBOX_POLICY_MAX> MailboxPolicyName;
+
+bool GetMailboxPolicy(const std::string& name, MailboxPolicy& policy);
+
+/*
+
+	Pose detector output is fanned out to consumers through a PoseSubscriber each
+	Every subscriber has its own bounded mailbox and thread, so a slow consumer only ever drops its own messages and never holds up the publisher or the other consumers
+
+	Messages are swapped in and out of the mailbox instead of copied, so once every buffer has gone around once a message with a frame doesn't allocate
+
+*/
+
+// frame and pose sent to consumers that draw the pose
+// assigning deep copies the frame into the existing buffer, the publisher's frame belongs to the frame pool and is reused as soon as it's released
+struct PoseFrame
+{
+	PoseFrame();
+	PoseFrame(const cv::Mat& frame, const PoseDetection& posedetection);
+	PoseFrame(const PoseFrame& rhs);
+	PoseFrame(PoseFrame&& rhs) = default;
+
+	PoseFrame& operator=(const PoseFrame& rhs);
+	PoseFrame& operator=(PoseFrame&& rhs) = default;
+
+	cv::Mat m_frame;
+	PoseDetection m_posedetection;
+};
+
+template<typename T>
+class Mailbox
+{
+public:
+	Mailbox(const MailboxPolicy policy = MAILBOX_POLICY_LATEST, const int32_t capacity = 1) :m_head(0), m_count(0), m_received(0), m_dropped(0), m_woken(false)
+	{
+		Configure(policy, capacity);
+	}
+
+	// keeps the newest messages that fit, anything beyond the new capacity counts as dropped
+	void Configure(const MailboxPolicy policy, const int32_t capacity)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		std::vector<T> items((policy == MAILBOX_POLICY_LATEST || capacity < 1) ? 1 : capacity);
+		const size_t keep = (std::min)(m_count, items.size());
+		for (size_t i = 0; i < keep; i++)
+		{
+			std::swap(items[i], m_items[(m_head + m_count - keep + i) % m_items.size()]);
+		}
+		m_dropped += m_count - keep;
+		m_items.swap(items);
+		m_head = 0;
+		m_count = keep;
+	}
+
+	// message is swapped into the mailbox, it comes back holding a dropped or already received message's buffers
+	void Push(T& message)
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			if (m_count == m_items.size())
+			{
+				m_head = (m_head + 1) % m_items.size();
+				m_count--;
+				m_dropped++;
+			}
+			std::swap(message, m_items[(m_head + m_count) % m_items.size()]);
+			m_count++;
+			m_received++;
+		}
+		m_cv.notify_one();
+	}
+
+	// waits up to timeout for a message, the previous contents of message are swapped back into the mailbox for reuse
+	// returns false on timeout or when Wake is called while the mailbox is empty
+	bool Pop(T& message, const std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const bool ready = m_cv.wait_for(lock, timeout, [this]() { return m_count > 0 || m_woken; });
+		m_woken = false;
+		if (!ready || m_count == 0)
+		{
+			return false;
+		}
+		std::swap(message, m_items[m_head]);
+		m_head = (m_head + 1) % m_items.size();
+		m_count--;
+		return true;
+	}
+
+	void Wake()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_woken = true;
+		}
+		m_cv.notify_all();
+	}
+
+	uint64_t Received() const
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		return m_received;
+	}
+
+	uint64_t Dropped() const
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		return m_dropped;
+	}
+
+private:
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::vector<T> m_items;				// ring of m_count messages starting at m_head
+	size_t m_head;
+	size_t m_count;
+	uint64_t m_received;
+	uint64_t m_dropped;
+	bool m_woken;						// Wake was called, ends the next or current wait in Pop
+
+};
+
+template<typename T>
+class PoseSubscriber :public IThread
+{
+public:
+	PoseSubscriber() :IThread(), m_receive(nullptr)
+	{
+
+	}
+
+	virtual ~PoseSubscriber()
+	{
+
+	}
+
+	struct PoseSubscriberParameters :public IThread::ThreadParameters
+	{
+		std::string m_name;
+		MailboxPolicy m_policy = MAILBOX_POLICY_LATEST;
+		int32_t m_capacity = 1;
+		std::function<void(const T&)> m_receive = nullptr;		// called on the subscriber's thread
+	};
+
+	// safe to call from any thread, never waits on the consumer
+	void Publish(const T& message)
+	{
+		std::lock_guard<std::mutex> guard(m_publishmutex);
+		m_staging = message;
+		m_mailbox.Push(m_staging);
+	}
+
+	virtual void Stop()
+	{
+		IThread::Stop();
+		m_mailbox.Wake();
+	}
+
+private:
+
+	void Run(const IThread::ThreadParameters* threadparameters)
+	{
+		try
+		{
+			const PoseSubscriberParameters params = *(dynamic_cast<const PoseSubscriberParameters*>(threadparameters));
+			m_name = params.m_name;
+			m_receive = params.m_receive;
+			m_mailbox.Configure(params.m_policy, params.m_capacity);
+
+			T message;
+			while (!m_stop)
+			{
+				if (m_mailbox.Pop(message, std::chrono::milliseconds(100)) && m_receive)
+				{
+					m_receive(message);
+				}
+			}
+
+			std::cout << "Subscriber " << m_name << " dropped " << m_mailbox.Dropped() << " of " << m_mailbox.Received() << " messages" << std::endl;
+		}
+		catch (std::exception& e)
+		{
+			std::cout << "PoseSubscriber::Run caught " << e.what() << std::endl;
+		}
+	}
+
+	std::string m_name;
+	std::function<void(const T&)> m_receive;
+	Mailbox<T> m_mailbox;
+	std::mutex m_publishmutex;
+	T m_staging;						// guarded by m_publishmutex
+
+};
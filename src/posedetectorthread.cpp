@@ -4,47 +4,21 @@
 #include <opencv2/imgproc.hpp>
 
 #include <onnxruntime_cxx_api.h>
-#include <dml/dml_provider_factory.h>
 
 #include "global.h"
-#include "opencvfunctions.h"
+#include "posemodelsession.h"
+#include "preprocessfunctions.h"
 
-#ifdef _WIN32
-#include <Windows.h>
-#include <timeapi.h>
-#pragma comment(lib,"winmm")
-#endif
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 
 //debug
 #include <iostream>
 
-/*
-
-	Movenet pose detector info
-	https://github.com/tensorflow/tfjs-models/blob/master/pose-detection/README.md
-
-*/
-
-const std::array<int32_t, 17> PoseDetectorThread::m_movenetkeypoints{ 
-	KEYPOINT_NOSE,
-	KEYPOINT_LEFT_EYE_CENTER,
-	KEYPOINT_RIGHT_EYE_CENTER,
-	KEYPOINT_LEFT_EAR,
-	KEYPOINT_RIGHT_EAR,
-	KEYPOINT_LEFT_SHOULDER,
-	KEYPOINT_RIGHT_SHOULDER,
-	KEYPOINT_LEFT_ELBOW,
-	KEYPOINT_RIGHT_ELBOW,
-	KEYPOINT_LEFT_WRIST,
-	KEYPOINT_RIGHT_WRIST,
-	KEYPOINT_LEFT_HIP,
-	KEYPOINT_RIGHT_HIP,
-	KEYPOINT_LEFT_KNEE,
-	KEYPOINT_RIGHT_KNEE,
-	KEYPOINT_LEFT_ANKLE,
-	KEYPOINT_RIGHT_ANKLE };
-
-PoseDetectorThread::PoseDetectorThread() :IThread()
+PoseDetectorThread::PoseDetectorThread() :IThread(), m_nextticket(0), m_nextdelivery(0), m_smartcrop(false), m_smartcropscore(0.2f), m_haslastdetection(false), m_trackkeypoints(false), m_trackslot(-1), m_ready(false), m_activemodel(POSE_MODEL_ACCURATE), m_latencybudget(0), m_latencyhysteresis(0.5), m_modelswitches(0)
 {
 
 }
@@ -54,13 +28,77 @@ PoseDetectorThread::~PoseDetectorThread()
 
 }
 
-void PoseDetectorThread::ReceiveFrame(const cv::Mat& img)
+void PoseDetectorThread::ReceiveFrame(const int32_t slot)
 {
-	if (!m_stop && !img.empty())
+	if (!m_stop && !m_framepool.Frame(slot).empty())
+	{
+		// the tracker thread moves the tracked pose on every frame it keeps up with, including the ones the model never sees
+		// it gets its own reference so the slot isn't reused until both it and the detector are done
+		if (m_trackkeypoints)
+		{
+			m_framepool.AddRef(slot);
+			const int32_t previous = m_trackslot.exchange(slot);
+			if (previous >= 0)
+			{
+				m_framepool.Release(previous);		// tracker didn't keep up with this frame
+			}
+			{
+				std::lock_guard<std::mutex> guard(m_trackmutex);
+			}
+			m_trackcv.notify_one();
+		}
+
+		m_framepool.Publish(slot);	// replaces any frame we haven't gotten to yet
+		{
+			// empty lock so the notify can't slip in between the detector checking the mailbox and starting to wait
+			std::lock_guard<std::mutex> guard(m_framemutex);
+		}
+		m_framecv.notify_one();
+	}
+	else
+	{
+		m_framepool.Release(slot);
+	}
+}
+
+bool PoseDetectorThread::WantsFrame() const
+{
+	// either the detector or the tracker is ready for another frame
+	return !m_framepool.HasLatest() || (m_trackkeypoints && m_trackslot < 0);
+}
+
+bool PoseDetectorThread::FramePending() const
+{
+	return m_framepool.HasLatest();
+}
+
+bool PoseDetectorThread::Idle()
+{
+	std::lock_guard<std::mutex> lock(m_framemutex);
+	return !m_framepool.HasLatest() && m_nextticket == m_nextdelivery;
+}
+
+bool PoseDetectorThread::Ready() const
+{
+	return m_ready;
+}
+
+FramePool* PoseDetectorThread::GetFramePool()
+{
+	return &m_framepool;
+}
+
+void PoseDetectorThread::Stop()
+{
+	IThread::Stop();
 	{
 		std::lock_guard<std::mutex> guard(m_framemutex);
-		m_frame.push(img);
 	}
+	m_framecv.notify_all();
+	{
+		std::lock_guard<std::mutex> guard(m_trackmutex);
+	}
+	m_trackcv.notify_all();
 }
 
 void PoseDetectorThread::Run(const IThread::ThreadParameters* threadparameters)
@@ -70,302 +108,419 @@ void PoseDetectorThread::Run(const IThread::ThreadParameters* threadparameters)
 		const PoseDetectorThreadParameters params = *(dynamic_cast<const PoseDetectorThreadParameters*>(threadparameters));
 		m_sendpose = params.m_sendpose;
 		m_senddetection = params.m_senddetection;
-		int64_t inputsize = 256;
+		m_frametaken = params.m_frametaken;
 
 		//debug
 		m_posediv = params.m_posediv;
 		m_poseadd = params.m_poseadd;
 
-		Ort::Env* env = new Ort::Env(ORT_LOGGING_LEVEL_ERROR, "posedetector");
-		Ort::SessionOptions session_options;
-		session_options.SetIntraOpNumThreads(1);
-		session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
-		Ort::AllocatorWithDefaultOptions* allocator = new Ort::AllocatorWithDefaultOptions();
-
-		// DirectML
-		if (params.m_usedirectml)
+		Ort::Env* env = nullptr;
+		if (params.m_globalthreadpool)
 		{
-			session_options.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
-			session_options.DisableMemPattern();
-
-			OrtApi const& ortApi = Ort::GetApi();
-			OrtDmlApi const* ortDmlApi = nullptr;
-			ortApi.GetExecutionProviderApi("DML", ORT_API_VERSION, reinterpret_cast<void const**>(&ortDmlApi));
-
-			ortApi.AddFreeDimensionOverrideByName(session_options, "batch_size", 1); // If your model has this dimension
-
-			ortDmlApi->SessionOptionsAppendExecutionProvider_DML(session_options, params.m_directmldevid);
+			Ort::ThreadingOptions threadingoptions;
+			threadingoptions.SetGlobalIntraOpNumThreads(params.m_intraopthreads);
+			threadingoptions.SetGlobalInterOpNumThreads(params.m_interopthreads);
+			threadingoptions.SetGlobalSpinControl(params.m_threadspinning);
+			if (!params.m_threadaffinity.empty())
+			{
+				Ort::ThrowOnError(Ort::GetApi().SetGlobalIntraOpThreadAffinity(threadingoptions, params.m_threadaffinity.c_str()));
+			}
+			env = new Ort::Env(threadingoptions, ORT_LOGGING_LEVEL_ERROR, "posedetector");
 		}
-
-		std::wstring onnxmodelwc{ L"" };
-		global::MultiByteToWideCharString(params.m_onnxmodel, onnxmodelwc);
-		Ort::Session* session = new Ort::Session(*env, onnxmodelwc.c_str(), session_options);
-
-		const size_t num_input_nodes = session->GetInputCount();
-		std::vector<const char*> input_node_names(num_input_nodes);
-		std::vector<std::string> input_node_strs(num_input_nodes);
-
-		for (int i = 0; i < num_input_nodes; i++)
+		else
 		{
-			input_node_strs[i] = session->GetInputNameAllocated(i, *allocator).get();
-			input_node_names[i] = input_node_strs[i].c_str();
+			env = new Ort::Env(ORT_LOGGING_LEVEL_ERROR, "posedetector");
 		}
 
-		ONNXTensorElementDataType inputtype = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
-		if (num_input_nodes > 0)
+		PoseModelSessionOptions sessionoptions;
+		sessionoptions.m_onnxmodel = params.m_onnxmodel;
+		sessionoptions.m_executionprovider = params.m_executionprovider;
+		sessionoptions.m_executionprovideroptions = params.m_executionprovideroptions;
+		sessionoptions.m_intraopthreads = params.m_intraopthreads;
+		sessionoptions.m_interopthreads = params.m_interopthreads;
+		sessionoptions.m_parallelexecution = params.m_parallelexecution;
+		sessionoptions.m_threadspinning = params.m_threadspinning;
+		sessionoptions.m_threadaffinity = params.m_threadaffinity;
+		sessionoptions.m_useglobalthreadpool = params.m_globalthreadpool;
+		sessionoptions.m_modelcachedir = params.m_modelcachedir;
+		sessionoptions.m_sharemodelmapping = params.m_sharemodelmapping;
+		std::vector<std::shared_ptr<MappedFile>> mappings;		// every model file the sessions mapped, kept while the detector runs so they all share one mapping
+		sessionoptions.m_mappings = &mappings;
+		sessionoptions.m_posenormalizeoverride = params.m_posenormalizeoverride;
+		sessionoptions.m_posediv = m_posediv;
+		sessionoptions.m_poseadd = m_poseadd;
+
+		PoseModelSessionOptions fastsessionoptions = sessionoptions;
+		fastsessionoptions.m_onnxmodel = params.m_onnxmodelfast;
+
+		m_activemodel = POSE_MODEL_ACCURATE;
+		m_latencybudget = params.m_latencybudget;
+		m_latencyhysteresis = params.m_latencyhysteresis;
+		m_modelnames[POSE_MODEL_ACCURATE] = std::filesystem::path(params.m_onnxmodel).stem().string();
+		m_modelnames[POSE_MODEL_FAST] = std::filesystem::path(params.m_onnxmodelfast).stem().string();
+		m_latency.fill(LatencyWindow());
+		m_modelswitches = 0;
+		m_laststats = std::chrono::steady_clock::now();
+
+		// every session thread gets its own session of each model, only one of them runs per frame
+		const int32_t sessioncount = std::clamp(params.m_sessions, 1, FramePool::DEFAULT_SIZE - 5);		// each session holds a frame, leave room for capture, the mailbox and the tracker's mailbox and frame
+		std::vector<std::array<PoseModelSession*, POSE_MODEL_MAX>> sessions;
+		for (int32_t i = 0; i < sessioncount; i++)
 		{
-			inputtype = session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType();
-			//std::cout << "Model input data type=" << (int)inputtype << std::endl;
-			std::vector<int64_t> input_shape = session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
-			if (input_shape.size() == 4 && input_shape[1] == input_shape[2] && input_shape[3] == 3)
-			{
-				inputsize = input_shape[2];
-			}
-			else
+			std::array<PoseModelSession*, POSE_MODEL_MAX> modelsessions{ nullptr, nullptr };
+			modelsessions[POSE_MODEL_ACCURATE] = new PoseModelSession(*env, sessionoptions);
+			if (!params.m_onnxmodelfast.empty())
 			{
-				// TODO - onnx input not in expected format
-				m_stop = true;
+				modelsessions[POSE_MODEL_FAST] = new PoseModelSession(*env, fastsessionoptions);
 			}
+			sessions.push_back(modelsessions);
 		}
-		else
+
+		m_nextticket = 0;
+		m_nextdelivery = 0;
+		m_smartcrop = params.m_smartcrop;
+		m_smartcropscore = params.m_smartcropscore;
+		m_haslastdetection = false;
+		m_motiongate.Configure(params.m_motionthreshold, params.m_motionmaxskip);
+		m_tracker.Configure(params.m_trackwidth, FramePool::DEFAULT_SIZE);
+		m_posetracker.Configure(params.m_posesubject, params.m_posesubjectid);
+		m_trackkeypoints = params.m_trackkeypoints;
+		m_pending.assign(sessioncount, PendingDetection());
+
+		// this thread runs the first session, the rest get their own threads
+		std::vector<std::thread> sessionthreads;
+		for (int32_t i = 1; i < sessioncount; i++)
 		{
-			// TODO - onnx model not in expected format
-			m_stop = true;
+			sessionthreads.push_back(std::thread(&PoseDetectorThread::RunSession, this, sessions[i]));
 		}
+		std::thread trackerthread;
+		if (m_trackkeypoints)
+		{
+			trackerthread = std::thread(&PoseDetectorThread::RunTracker, this);
+		}
+
+		m_ready = true;
+		RunSession(sessions[0]);
+		m_ready = false;
+		m_trackkeypoints = false;
 
-		const size_t num_output_nodes = session->GetOutputCount();
-		std::vector<const char*> output_node_names(num_output_nodes);
-		std::vector<std::string> output_node_strs(num_output_nodes);
+		for (std::vector<std::thread>::iterator i = sessionthreads.begin(); i != sessionthreads.end(); i++)
+		{
+			(*i).join();
+		}
+		if (trackerthread.joinable())
+		{
+			trackerthread.join();
+		}
+		m_framepool.Release(m_trackslot.exchange(-1));
 
-		for (int i = 0; i < num_output_nodes; i++)
+		for (std::vector<std::array<PoseModelSession*, POSE_MODEL_MAX>>::iterator i = sessions.begin(); i != sessions.end(); i++)
 		{
-			output_node_strs[i] = session->GetOutputNameAllocated(i, *allocator).get();
-			output_node_names[i] = output_node_strs[i].c_str();
+			for (std::array<PoseModelSession*, POSE_MODEL_MAX>::iterator j = (*i).begin(); j != (*i).end(); j++)
+			{
+				delete (*j);
+			}
 		}
+		sessions.clear();
+		mappings.clear();
 
-		Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-		std::vector<int64_t> input_node_dim(4, 0);
-		input_node_dim[0] = 1;			// batch size
-		input_node_dim[1] = inputsize;	// width of image
-		input_node_dim[2] = inputsize;	// height of image
-		input_node_dim[3] = 3;			// channels
+		if (env)
+		{
+			delete env;
+			env = nullptr;
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "PoseDetectorThread::Run caught " << e.what() << std::endl;
+	}
 
-		std::vector<float> floatinput(inputsize * inputsize * 3LL, 0);
-		std::vector<uint8_t> uint8input(inputsize * inputsize * 3LL, 0);
-		cv::Mat imin;
-		cv::Mat imout;
-		std::chrono::high_resolution_clock::time_point timestamp;
+	std::cout << "PoseDetectorThread::Run Thread Complete" << std::endl;
 
-#ifdef _WIN32
-		timeBeginPeriod(1);
-#endif
+}
 
-		while (!m_stop)
+void PoseDetectorThread::RunTracker()
+{
+	while (!m_stop)
+	{
+		int32_t slot = -1;
 		{
-			bool process = false;
+			std::unique_lock<std::mutex> lock(m_trackmutex);
+			m_trackcv.wait(lock, [this, &slot]() { return m_stop || (slot = m_trackslot.exchange(-1)) >= 0; });
+		}
+		if (slot >= 0)
+		{
+			PoseDetection posedetection;
+			if (m_tracker.Track(m_framepool.Sequence(slot), m_framepool.Timestamp(slot), m_framepool.Frame(slot), posedetection))
 			{
-				std::lock_guard<std::mutex> guard(m_framemutex);
-				while (m_frame.size() > 1)	// ignore any excess frames since we aren't keeping up with them
-				{
-					m_frame.pop();
-				}
-				if (!m_frame.empty())
+				for (std::vector<std::function<void(const PoseDetection&)>>::iterator i = m_senddetection.begin(); i != m_senddetection.end(); i++)
 				{
-					imin = m_frame.front();
-					m_frame.pop();
-					process = true;
-					timestamp = std::chrono::high_resolution_clock::now();
+					if ((*i))
+					{
+						(*i)(posedetection);
+					}
 				}
 			}
-			if (process)
-			{
-				// debug
-				// std::cout << "Processing " << imin.cols << " x " << imin.rows << std::endl;
-				int32_t imageoffsetx = 0;
-				int32_t imageoffsety = 0;
-				float imagescale = 1.0;
-				ResizeCropImage(imin, imout, inputsize, imageoffsetx, imageoffsety, imagescale);
-
-				Ort::Value input_tensor(nullptr);
-				if (inputtype == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
-				{
-					//std::cout << "Setting float tensor input" << std::endl;
-					SetONNXFloatInput(imout, floatinput.data());
-					input_tensor = Ort::Value::CreateTensor<float>(memory_info, floatinput.data(), floatinput.size(), input_node_dim.data(), input_node_dim.size());
-				}
-				else if (ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8)
-				{
-					//std::cout << "Setting uint8 tensor input" << std::endl;
-					SetONNXUint8Input(imout, uint8input.data());
-					input_tensor = Ort::Value::CreateTensor<uint8_t>(memory_info, uint8input.data(), uint8input.size(), input_node_dim.data(), input_node_dim.size());
-				}
-
-				//std::cout << "Running model" << std::endl;
-				auto output_tensors = session->Run(Ort::RunOptions{ nullptr }, input_node_names.data(), &input_tensor, 1, output_node_names.data(), output_node_names.size());
-				//std::cout << "After model" << std::endl;
-				
-				/*
-				Hi!
+			m_framepool.Release(slot);
+		}
+	}
+}
 
-			As for the model input we divide RGB image with [0, 255] values by 255.0 to get [0, 1] values. So the second formula.
+void PoseDetectorThread::RunSession(const std::array<PoseModelSession*, POSE_MODEL_MAX> sessions)
+{
+	while (!m_stop)
+	{
+		// only the latest frame is kept, any frames we didn't keep up with were already recycled
+		// a session can't start on a new frame while as many frames as there are sessions are still waiting to be delivered
+		int32_t slot = -1;
+		uint64_t ticket = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_framemutex);
+			m_framecv.wait(lock, [this, &slot]() { return m_stop || ((m_nextticket - m_nextdelivery) < m_pending.size() && (slot = m_framepool.TakeLatest()) >= 0); });
+			if (slot >= 0)
+			{
+				ticket = m_nextticket++;
+			}
+		}
+		if (slot >= 0)
+		{
+			for (std::vector<std::function<void()>>::iterator i = m_frametaken.begin(); i != m_frametaken.end(); i++)
+			{
+				(*i)();
+			}
 
-			As for the outputs, you are interested in first two:
+			const cv::Mat& imin = m_framepool.Frame(slot);
 
-			(1, 155) = (1, 31 * 5) - 33 landmarks, represented as (x, y, z, visibility, presence) each, in a flatten format. presence means landmark is within the frame bound, visibility means landmark is present and not occluded by other objects or body parts.
-			(1, 1) - Pose presence flag as x from sigmoid(x). Meaning if you apply sigmoid to it, you'll get value in [0, 1] range.
-				*/
+			// debug
+			// std::cout << "Processing " << imin.cols << " x " << imin.rows << std::endl;
 
-				/*
-				# Tensors from mode inference of
-				# "mediapipe/modules/pose_landmark/pose_landmark_lite|full|heavy.tflite".
-				# (std::vector<Tensor>)
-				# tensors[0]: landmarks
-				# tensors[1]: pose flag
-				# tensors[2]: segmentation
-				# tensors[3]: heatmap
-				# tensors[4]: world landmarks
-			*/
+			std::vector<PoseDetection> poses;
 
-			// TODO - check which model we're running and process output based on that
+			// a frame that looks the same as the last one the model ran on gets the last pose again
+			PoseDetection lastdetection;
+			if (!m_motiongate.Changed(imin) && GetLastDetection(lastdetection))
+			{
+				poses.push_back(lastdetection);
+				DeliverDetection(ticket, slot, poses, true, true);
+				continue;
+			}
 
-				PoseDetection posedetection;
-				posedetection.m_timestamp = timestamp;
-				float* output = output_tensors[0].GetTensorMutableData<float>();
+			const int32_t active = m_activemodel;
+			const PoseModel model = sessions[active] ? static_cast<PoseModel>(active) : POSE_MODEL_ACCURATE;
 
-				// TODO - beter detection of model type
-				if (num_output_nodes == 1)
+			bool detected = false;
+			try
+			{
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				if (m_smartcrop)
 				{
-					for (int i = 0; i < 17; i++)
-					{
-						//std::cout << i << " " << output[(i * 3) + 0] << "," << output[(i * 3) + 1] << "\t" << output[(i * 3) + 2] << std::endl;
-						//cv::circle(imout, cv::Point(output[(i * 3) + 1] * static_cast<float>(inputsize), output[(i * 3) + 0] * static_cast<float>(inputsize)), 2, cv::Scalar(0.0, 255, 0, 0.0), 1, 8, 0);
-
-						posedetection.m_keypoints[m_movenetkeypoints[i]].m_pos.m_x = (output[(i * 3) + 1] * static_cast<float>(inputsize) * imagescale) + imageoffsetx;
-						posedetection.m_keypoints[m_movenetkeypoints[i]].m_pos.m_y = (output[(i * 3) + 0] * static_cast<float>(inputsize) * imagescale) + imageoffsety;
-						if (output[(i * 3) + 2] > 0.5)
-						{
-							posedetection.m_keypoints[m_movenetkeypoints[i]].m_presence = KEYPOINT_PRESENCE_PRESENT;
-						}
-					}
-
+					int32_t cropx = 0;
+					int32_t cropy = 0;
+					int32_t cropsize = 0;
+					GetCropRegion(imin.cols, imin.rows, cropx, cropy, cropsize);
+					sessions[model]->Detect(imin, cropx, cropy, cropsize, poses);
 				}
-
-
-			/*
-			float* output = output_tensors[0].GetTensorMutableData<float>();
-			for (int i = 0; i < 33; i++)
-			{
-				std::cout << i << "\t" << output[(i * 5) + 0] << ", " << output[(i * 5) + 1] << ", " << output[(i * 5) + 2] << "\t" << output[(i * 5) + 3] << "\t" << output[(i * 5) + 4] << std::endl;
-				if (output[(i * 5) + 4] > 0.5)
+				else
 				{
-					cv::circle(imout, cv::Point(output[(i * 5) + 0], output[(i * 5) + 1]), 2, cv::Scalar(0.0, 255.0, 0.0), 1, 8, 0);
+					sessions[model]->Detect(imin, poses);
 				}
+				detected = true;
+				RecordLatency(model, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
 			}
+			catch (std::exception& e)
+			{
+				// still deliver the ticket so later frames aren't held up
+				std::cout << "PoseDetectorThread::RunSession caught " << e.what() << std::endl;
+			}
+
+			DeliverDetection(ticket, slot, poses, detected, false);
+		}
+	}
+}
+
+void PoseDetectorThread::DeliverDetection(const uint64_t ticket, const int32_t slot, const std::vector<PoseDetection>& poses, const bool detected, const bool reused)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_delivermutex);
 
-			/*
-			float* outputsegment = output_tensors[2].GetTensorMutableData<float>();
-			int64_t pix = 0;
-			for (int64_t y = 0; y < imout.rows; y++)
+		PendingDetection& pending = m_pending[ticket % m_pending.size()];
+		pending.m_slot = slot;
+		pending.m_detected = detected;
+		pending.m_reused = reused;
+		pending.m_poses = poses;
+		pending.m_ready = true;
+
+		// send everything that is now in order
+		for (PendingDetection* next = &m_pending[m_nextdelivery % m_pending.size()]; next->m_ready; next = &m_pending[m_nextdelivery % m_pending.size()])
+		{
+			if (next->m_detected)
 			{
-				for (int64_t x = 0; x < imout.cols; x++, pix++)
+				// people are tracked in frame order, only the subject's pose is sent on, with no keypoints if the subject wasn't found
+				const cv::Mat& imin = m_framepool.Frame(next->m_slot);
+				const int32_t subject = m_posetracker.Update(next->m_poses, imin.cols, imin.rows);
+				next->m_posedetection = (subject >= 0) ? next->m_poses[subject] : PoseDetection();
+				next->m_posedetection.m_timestamp = m_framepool.Timestamp(next->m_slot);
+				next->m_posedetection.m_sequence = m_framepool.Sequence(next->m_slot);
+
+				m_lastdetection = next->m_posedetection;
+				m_haslastdetection = true;
+
+				// send original image and detected landmarks downstream
+				for (std::vector<std::function<void(const cv::Mat&, const PoseDetection&)>>::iterator i = m_sendpose.begin(); i != m_sendpose.end(); i++)
 				{
-					if (outputsegment[pix] < 0.3)
+					if ((*i))
 					{
-						imout.data[(pix * 3) + 0] = 0;
-						imout.data[(pix * 3) + 1] = 0;
-						imout.data[(pix * 3) + 2] = 0;
+						(*i)(imin, next->m_posedetection);
 					}
 				}
-			}
-			*/
-
-				// send original image and detected landmarks downstream
 
-				for (std::vector<std::function<void(const cv::Mat&, const PoseDetection&)>>::iterator i = m_sendpose.begin(); i != m_sendpose.end(); i++)
+				// with tracking the detection only corrects the tracked pose, which goes out with the next camera frame
+				if (m_trackkeypoints)
 				{
-					if ((*i))
+					if (!next->m_reused)
 					{
-						(*i)(imin, posedetection);
+						m_tracker.Anchor(next->m_posedetection.m_sequence, next->m_posedetection);
 					}
 				}
-				for (std::vector<std::function<void(const PoseDetection&)>>::iterator i = m_senddetection.begin(); i != m_senddetection.end(); i++)
+				else
 				{
-					if ((*i))
+					for (std::vector<std::function<void(const PoseDetection&)>>::iterator i = m_senddetection.begin(); i != m_senddetection.end(); i++)
 					{
-						(*i)(posedetection);
+						if ((*i))
+						{
+							(*i)(next->m_posedetection);
+						}
 					}
 				}
 			}
-			else
-			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-			}
+
+			m_framepool.Release(next->m_slot);
+			next->m_ready = false;
+			next->m_slot = -1;
+			m_nextdelivery++;
 		}
+	}
+
+	// a session may be waiting for room in the ring
+	{
+		std::lock_guard<std::mutex> guard(m_framemutex);
+	}
+	m_framecv.notify_all();
+}
+
+bool PoseDetectorThread::GetLastDetection(PoseDetection& posedetection)
+{
+	std::lock_guard<std::mutex> guard(m_delivermutex);
+	if (m_haslastdetection)
+	{
+		posedetection = m_lastdetection;
+	}
+	return m_haslastdetection;
+}
+
+void PoseDetectorThread::GetCropRegion(const int32_t width, const int32_t height, int32_t& cropx, int32_t& cropy, int32_t& cropsize)
+{
+	// the latest delivered pose is the closest we have to this frame, with several sessions it may be a few frames old
+	// the whole frame when we don't have a pose to go by, so a subject anywhere in the frame can be found again
+	PoseDetection lastdetection;
+	if (!GetLastDetection(lastdetection) || !GetPoseCrop(lastdetection, width, height, m_smartcropscore, cropx, cropy, cropsize))
+	{
+		GetFullFrameCrop(width, height, cropx, cropy, cropsize);
+	}
+}
+
+void PoseDetectorThread::RecordLatency(const PoseModel model, const float ms)
+{
+	std::lock_guard<std::mutex> guard(m_statsmutex);
 
-#ifdef _WIN32
-		timeEndPeriod(1);
-#endif
+	m_latency[model].Add(ms);
 
-		if (allocator)
+	// frames started before a switch still report to the model they ran on, only the active model's window decides
+	// the window of the model being switched to starts empty so it has to fill up again before switching back
+	if (m_latencybudget > 0 && !m_modelnames[POSE_MODEL_FAST].empty() && model == m_activemodel && m_latency[model].Full())
+	{
+		const float p95 = m_latency[model].Percentile(0.95f);
+		PoseModel next = model;
+		if (model == POSE_MODEL_ACCURATE && p95 > m_latencybudget)
 		{
-			delete allocator;
-			allocator = nullptr;
+			next = POSE_MODEL_FAST;
 		}
-
-		if (session)
+		else if (model == POSE_MODEL_FAST && p95 < m_latencybudget * m_latencyhysteresis)
 		{
-			delete session;
-			session = nullptr;
+			next = POSE_MODEL_ACCURATE;
 		}
 
-		if (env)
+		if (next != model)
 		{
-			delete env;
-			env = nullptr;
+			m_latency[next].Clear();
+			m_activemodel = next;
+			m_modelswitches++;
+			std::ostringstream msg;
+			msg << "Pose model " << m_modelnames[model] << " p95 " << std::fixed << std::setprecision(1) << p95 << " ms with a budget of " << m_latencybudget << " ms, switching to " << m_modelnames[next];
+			std::cout << msg.str() << std::endl;
 		}
 	}
-	catch (std::exception& e)
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_laststats >= std::chrono::seconds(10))
 	{
-		std::cout << "PoseDetectorThread::Run caught " << e.what() << std::endl;
+		m_laststats = now;
+		std::ostringstream msg;
+		msg << "Pose model " << m_modelnames[m_activemodel] << " active" << std::fixed << std::setprecision(1);
+		for (int32_t i = 0; i < POSE_MODEL_MAX; i++)
+		{
+			if (!m_latency[i].Empty())
+			{
+				msg << ", " << m_modelnames[i] << " p95 " << m_latency[i].Percentile(0.95f) << " ms";
+			}
+		}
+		msg << ", " << m_modelswitches << " switches";
+		if (m_motiongate.Enabled())
+		{
+			msg << ", " << m_motiongate.Skipped() << " unchanged frames skipped";
+		}
+		std::cout << msg.str() << std::endl;
 	}
-
-	std::cout << "PoseDetectorThread::Run Thread Complete" << std::endl;
-
 }
 
-void PoseDetectorThread::SetONNXFloatInput(const cv::Mat& img, float* data)
+PoseDetectorThread::LatencyWindow::LatencyWindow() :m_samples(), m_count(0), m_next(0)
 {
-	// OpenCV stores as BGR by default
-
-	// TODO - copy to data (swap r and b) first, then do AVX instructions for multiply and add
-
-	const uint8_t* imgdata = img.data;
-
-	for (int64_t pix = 0; pix < img.rows * img.cols; pix++)
-	{
 
-		data[(pix * 3) + 0] = (static_cast<float>(imgdata[(pix * 3) + 2]) / m_posediv) + m_poseadd;
-		data[(pix * 3) + 1] = (static_cast<float>(imgdata[(pix * 3) + 1]) / m_posediv) + m_poseadd;
-		data[(pix * 3) + 2] = (static_cast<float>(imgdata[(pix * 3) + 0]) / m_posediv) + m_poseadd;
-		
-	}
+}
 
+void PoseDetectorThread::LatencyWindow::Add(const float ms)
+{
+	m_samples[m_next] = ms;
+	m_next = (m_next + 1) % m_samples.size();
+	m_count = (std::min)(m_count + 1, m_samples.size());
 }
 
-void PoseDetectorThread::SetONNXUint8Input(const cv::Mat& img, uint8_t* data)
+void PoseDetectorThread::LatencyWindow::Clear()
 {
+	m_count = 0;
+	m_next = 0;
+}
 
-	// OpenCV stores as BGR by default
+bool PoseDetectorThread::LatencyWindow::Full() const
+{
+	return m_count == m_samples.size();
+}
 
-	const uint8_t* imgdata = img.data;
+bool PoseDetectorThread::LatencyWindow::Empty() const
+{
+	return m_count == 0;
+}
 
-	for (int64_t pix = 0; pix < img.rows * img.cols; pix++)
+float PoseDetectorThread::LatencyWindow::Percentile(const float p) const
+{
+	if (m_count == 0)
 	{
-
-		data[(pix * 3) + 0] = (static_cast<float>(imgdata[(pix * 3) + 2]) / m_posediv) + m_poseadd;
-		data[(pix * 3) + 1] = (static_cast<float>(imgdata[(pix * 3) + 1]) / m_posediv) + m_poseadd;
-		data[(pix * 3) + 2] = (static_cast<float>(imgdata[(pix * 3) + 0]) / m_posediv) + m_poseadd;
-
+		return 0;
 	}
 
+	// samples fill the front of the array until it wraps, so the first m_count are always the valid ones
+	std::array<float, 30> sorted = m_samples;
+	const size_t n = (std::min)(static_cast<size_t>(p * m_count), m_count - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + n, sorted.begin() + m_count);
+	return sorted[n];
 }
@@ -2,8 +2,11 @@
 
 #include "ithread.h"
 
-#include <queue>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <condition_variable>
 #include <functional>
 #include <string>
 #include <cstdint>
@@ -12,6 +15,13 @@
 #include <opencv2/core/mat.hpp>
 
 #include "posekeypointdata.h"
+#include "executionprovider.h"
+#include "framepool.h"
+#include "keypointtracker.h"
+#include "motiongate.h"
+#include "posetracker.h"
+
+class PoseModelSession;
 
 class PoseDetectorThread :public IThread
 {
@@ -19,34 +29,135 @@ public:
 	PoseDetectorThread();
 	virtual ~PoseDetectorThread();
 
+	enum PoseModel
+	{
+		POSE_MODEL_ACCURATE = 0,	// m_onnxmodel e.g. MoveNet Thunder
+		POSE_MODEL_FAST,			// m_onnxmodelfast e.g. MoveNet Lightning
+		POSE_MODEL_MAX
+	};
+
 	struct PoseDetectorThreadParameters :public IThread::ThreadParameters
 	{
 		std::vector<std::function<void(const cv::Mat&, const PoseDetection&)>> m_sendpose;
 		std::vector<std::function<void(const PoseDetection&)>> m_senddetection;
+		std::vector<std::function<void()>> m_frametaken;		// called when a session takes the published frame, FramePending() is false by then
 		std::string m_onnxmodel{ "" };
-		bool m_usedirectml{ false };
-		int32_t m_directmldevid{ 0 };
+		std::string m_onnxmodelfast{ "" };		// optional, loaded alongside m_onnxmodel and used while inference is over the latency budget
+		float m_latencybudget{ 0.0 };			// ms, p95 inference time that switches to the fast model, 0 to always use m_onnxmodel
+		float m_latencyhysteresis{ 0.5 };		// switch back once the fast model's p95 is below this fraction of the budget
+		ExecutionProvider m_executionprovider{ EXECUTION_PROVIDER_CPU };
+		ExecutionProviderOptions m_executionprovideroptions;
+		int32_t m_intraopthreads{ 1 };
+		int32_t m_interopthreads{ 0 };
+		bool m_parallelexecution{ false };
+		bool m_threadspinning{ true };
+		std::string m_threadaffinity{ "" };
+		bool m_globalthreadpool{ false };		// one ORT thread pool shared by every session in the process
+		std::string m_modelcachedir{ "" };
+		bool m_sharemodelmapping{ true };		// sessions loading the same model file use one memory mapping
+		int32_t m_sessions{ 1 };				// sessions running inference on consecutive frames at the same time
+		bool m_smartcrop{ false };				// crop around the last detected pose instead of the center of the frame
+		float m_smartcropscore{ 0.2f };			// keypoint score the torso needs for a smart crop, below it the whole frame is used
+		float m_motionthreshold{ 0.0 };			// mean gray level change below which a frame reuses the last pose instead of running the model, 0 to always run
+		int32_t m_motionmaxskip{ 15 };			// frames in a row that can reuse the last pose
+		bool m_trackkeypoints{ false };			// follow keypoints with optical flow on every camera frame, m_senddetection then gets a pose per camera frame
+		int32_t m_trackwidth{ 320 };			// frames are scaled down to this width for tracking
+		PoseSubject m_posesubject{ POSE_SUBJECT_LARGEST };	// which person to follow with multi pose models
+		int32_t m_posesubjectid{ -1 };			// track id to follow with POSE_SUBJECT_PINNED
 
 		//debug
+		bool m_posenormalizeoverride{ false };	// m_posediv and m_poseadd replace the model's own normalization
 		float m_posediv;
 		float m_poseadd;
 	};
 
-	void ReceiveFrame(const cv::Mat& img);
+	void ReceiveFrame(const int32_t slot);		// takes ownership of a slot from GetFramePool()
+	bool WantsFrame() const;					// false while a frame is already waiting for a session and the next one would only replace it
+	bool FramePending() const;					// a published frame hasn't been taken by a session yet
+	bool Idle();								// nothing waiting and every frame taken has been delivered
+	bool Ready() const;							// the models are loaded and the sessions are waiting for frames
+
+	FramePool* GetFramePool();
+
+	void Stop();
 
 private:
 
 	void Run(const IThread::ThreadParameters* threadparameters);
 
-	void SetONNXFloatInput(const cv::Mat& img, float* data);
-	void SetONNXUint8Input(const cv::Mat& img, uint8_t* data);
+	struct PendingDetection
+	{
+		int32_t m_slot{ -1 };
+		bool m_ready{ false };
+		bool m_detected{ false };
+		bool m_reused{ false };					// last pose sent again for an unchanged frame
+		std::vector<PoseDetection> m_poses;		// everyone the model found
+		PoseDetection m_posedetection;			// the subject, picked on delivery
+	};
+
+	// inference times of the most recent frames run on one model
+	class LatencyWindow
+	{
+	public:
+		LatencyWindow();
+		void Add(const float ms);
+		void Clear();
+		bool Full() const;
+		bool Empty() const;
+		float Percentile(const float p) const;
+	private:
+		std::array<float, 30> m_samples;
+		size_t m_count;
+		size_t m_next;
+	};
+
+	void RunSession(const std::array<PoseModelSession*, POSE_MODEL_MAX> sessions);
+	void RunTracker();
+	void RecordLatency(const PoseModel model, const float ms);
+	bool GetLastDetection(PoseDetection& posedetection);
+	void GetCropRegion(const int32_t width, const int32_t height, int32_t& cropx, int32_t& cropy, int32_t& cropsize);
+	void DeliverDetection(const uint64_t ticket, const int32_t slot, const std::vector<PoseDetection>& poses, const bool detected, const bool reused);
 
 	std::vector<std::function<void(const cv::Mat&, const PoseDetection&)>> m_sendpose;
 	std::vector<std::function<void(const PoseDetection&)>> m_senddetection;
+	std::vector<std::function<void()>> m_frametaken;
+	FramePool m_framepool;
 	std::mutex m_framemutex;
-	std::queue<cv::Mat> m_frame;
+	std::condition_variable m_framecv;		// signalled when a frame is published, a detection is delivered or the thread is stopped
+
+	// frames are numbered in the order sessions take them so results can be delivered in capture order
+	uint64_t m_nextticket;								// guarded by m_framemutex
+	std::atomic<uint64_t> m_nextdelivery;
+	std::mutex m_delivermutex;
+	std::vector<PendingDetection> m_pending;			// ring indexed by ticket, one entry per session
+
+	// smart cropping
+	bool m_smartcrop;
+	float m_smartcropscore;
+	bool m_haslastdetection;							// guarded by m_delivermutex
+	PoseDetection m_lastdetection;						// guarded by m_delivermutex, latest delivered detection
+	PoseTracker m_posetracker;							// guarded by m_delivermutex
+
+	MotionGate m_motiongate;
+
+	// keypoint tracking
+	std::atomic<bool> m_trackkeypoints;					// set once m_senddetection is, frames arriving before that aren't tracked
+	KeypointTracker m_tracker;
+	std::atomic<int32_t> m_trackslot;					// latest frame for the tracker thread, which holds its own reference to the slot, -1 if none
+	std::mutex m_trackmutex;
+	std::condition_variable m_trackcv;					// signalled when a frame is waiting for the tracker or the thread is stopped
+
+	std::atomic<bool> m_ready;
 
-	static const std::array<int32_t, 17> m_movenetkeypoints;		// movenet keypoint index to our keypoint list
+	// model switching
+	std::atomic<int32_t> m_activemodel;
+	float m_latencybudget;
+	float m_latencyhysteresis;
+	std::mutex m_statsmutex;
+	std::array<LatencyWindow, POSE_MODEL_MAX> m_latency;	// guarded by m_statsmutex
+	std::array<std::string, POSE_MODEL_MAX> m_modelnames;
+	uint64_t m_modelswitches;							// guarded by m_statsmutex
+	std::chrono::steady_clock::time_point m_laststats;	// guarded by m_statsmutex
 
 	//debug
 	float m_posediv;
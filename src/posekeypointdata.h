@@ -2,6 +2,7 @@
 
 #include <array>
 #include <chrono>
+#include <cstdint>
 #include <string>
 
 enum KeypointLocation
@@ -73,12 +74,16 @@ struct KeypointDetection
 {
 	KeypointPresence m_presence{ KEYPOINT_PRESENCE_UNKNOWN };
 	KeypointPosition m_pos;
+	float m_score{ 0.0 };		// model confidence 0 - 1
 };
 
 struct PoseDetection
 {
+	int32_t m_id{ -1 };			// person track id, -1 if not tracked
+	float m_score{ 0.0 };		// model confidence that this is a person 0 - 1
 	std::array<KeypointDetection, KeypointLocation::KEYPOINT_MAX> m_keypoints;
-	std::chrono::high_resolution_clock::time_point m_timestamp;
+	std::chrono::steady_clock::time_point m_timestamp;		// when the frame was captured
+	uint64_t m_sequence{ 0 };								// capture order of the frame, starting at 1
 };
 
 struct PoseTrackingData
@@ -94,7 +99,8 @@ struct PoseTrackingData
 struct PoseMovement
 {
 	std::array<PoseTrackingData, PoseTrackingLocation::POSE_TRACKING_MAX> m_posetracking;
-	std::chrono::high_resolution_clock::time_point m_timestamp;
+	std::chrono::steady_clock::time_point m_timestamp;		// capture time of the newest pose it includes
+	uint64_t m_sequence{ 0 };
 };
 
 template<class InputIt>
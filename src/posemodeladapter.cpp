@@ -0,0 +1,478 @@
+#include "posemodeladapter.h"
+
+#include <array>
+#include <cmath>
+
+namespace
+{
+
+/*
+
+	Model traits
+	Each model describes its signature, landmark layout and keypoint mapping here, PoseModelAdapterT turns that into an adapter with the decode loop built for that model
+
+	KEYPOINT_COUNT, STRIDE		landmarks in the landmark output and floats per landmark
+	POSE_COUNT, POSE_STRIDE		poses in the landmark output and floats per pose
+	DYNAMIC_INPUT_SIZE			input size used when the model's input size isn't fixed, 0 if it has to be
+	INPUT_LAYOUT				layout of the original model, NCHW conversions are detected from the input shape and this only decides when the shape fits both
+	m_keypoints					landmark index to our keypoint list, 0 for landmarks we don't use
+	MatchOutputs				finds the model's outputs in the signature, landmarks first
+	PoseScore					score for a whole pose, multi pose models drop poses below the threshold, single pose models mark their keypoints not present
+	X, Y, Z, Score				one landmark, positions in model input pixels
+
+*/
+
+float Sigmoid(const float x)
+{
+	return 1.0f / (1.0f + std::exp(-x));
+}
+
+/*
+
+	Movenet pose detector info
+	https://github.com/tensorflow/tfjs-models/blob/master/pose-detection/README.md
+
+	input [1, size, size, 3] RGB 0 - 255, 192 for lightning, 256 for thunder, [1, 3, size, size] in NCHW conversions
+	output [1, 1, 17, 3] y, x, score with y and x normalized to 0 - 1
+
+*/
+
+struct MoveNetTraits
+{
+	static constexpr size_t KEYPOINT_COUNT = 17;
+	static constexpr size_t STRIDE = 3;
+	static constexpr size_t POSE_COUNT = 1;
+	static constexpr size_t POSE_STRIDE = 0;
+	static constexpr int64_t DYNAMIC_INPUT_SIZE = 0;
+	static constexpr TensorLayout INPUT_LAYOUT = TENSOR_LAYOUT_NHWC;
+	static constexpr size_t OUTPUT_COUNT = 1;
+	static constexpr float KEYPOINT_THRESHOLD = 0.5f;
+	static constexpr float POSE_THRESHOLD = 0.0f;
+	static constexpr float NORMALIZE_DIV = 1.0f;
+	static constexpr float NORMALIZE_ADD = 0.0f;
+
+	static const std::string m_name;
+	static const std::array<int32_t, KEYPOINT_COUNT> m_keypoints;
+
+	static bool SupportsInputType(const ONNXTensorElementDataType type)
+	{
+		// the TensorFlow model takes int32, conversions and quantized models may use any of these
+		return type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT || type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 || type == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 ||
+			type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 || type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32;
+	}
+
+	static bool MatchOutputs(const PoseModelSignature& signature, std::array<size_t, OUTPUT_COUNT>& outputs)
+	{
+		const std::vector<int64_t> shape{ 1, 1, KEYPOINT_COUNT, STRIDE };
+		if (signature.m_outputs.size() == 1 && signature.m_outputs[0].m_shape == shape)
+		{
+			outputs[0] = 0;
+			return true;
+		}
+		return false;
+	}
+
+	static float PoseScore(const std::vector<const float*>& outputs, const size_t pose)
+	{
+		return 1.0f;
+	}
+
+	static float X(const float* landmark, const float inputsize)
+	{
+		return landmark[1] * inputsize;
+	}
+
+	static float Y(const float* landmark, const float inputsize)
+	{
+		return landmark[0] * inputsize;
+	}
+
+	static float Z(const float* landmark, const float inputsize)
+	{
+		return 0.0f;
+	}
+
+	static float Score(const float* landmark)
+	{
+		return landmark[2];
+	}
+};
+
+const std::string MoveNetTraits::m_name{ "MoveNet single pose" };
+
+const std::array<int32_t, MoveNetTraits::KEYPOINT_COUNT> MoveNetTraits::m_keypoints{
+	KEYPOINT_NOSE,
+	KEYPOINT_LEFT_EYE_CENTER,
+	KEYPOINT_RIGHT_EYE_CENTER,
+	KEYPOINT_LEFT_EAR,
+	KEYPOINT_RIGHT_EAR,
+	KEYPOINT_LEFT_SHOULDER,
+	KEYPOINT_RIGHT_SHOULDER,
+	KEYPOINT_LEFT_ELBOW,
+	KEYPOINT_RIGHT_ELBOW,
+	KEYPOINT_LEFT_WRIST,
+	KEYPOINT_RIGHT_WRIST,
+	KEYPOINT_LEFT_HIP,
+	KEYPOINT_RIGHT_HIP,
+	KEYPOINT_LEFT_KNEE,
+	KEYPOINT_RIGHT_KNEE,
+	KEYPOINT_LEFT_ANKLE,
+	KEYPOINT_RIGHT_ANKLE };
+
+/*
+
+	Movenet multi pose
+	https://tfhub.dev/google/movenet/multipose/lightning/1
+
+	input [1, height, width, 3] RGB 0 - 255, height and width multiples of 32, often left dynamic
+	output [1, 6, 56] up to 6 people, each 17 keypoints as y, x, score followed by ymin, xmin, ymax, xmax, score of the person
+
+*/
+
+struct MoveNetMultiPoseTraits :public MoveNetTraits
+{
+	static constexpr size_t POSE_COUNT = 6;
+	static constexpr size_t POSE_STRIDE = 56;
+	static constexpr int64_t DYNAMIC_INPUT_SIZE = 256;
+	static constexpr float KEYPOINT_THRESHOLD = 0.3f;
+	static constexpr float POSE_THRESHOLD = 0.25f;
+
+	static const std::string m_name;
+
+	static bool MatchOutputs(const PoseModelSignature& signature, std::array<size_t, OUTPUT_COUNT>& outputs)
+	{
+		const std::vector<int64_t> shape{ 1, POSE_COUNT, POSE_STRIDE };
+		if (signature.m_outputs.size() == 1 && signature.m_outputs[0].m_shape == shape)
+		{
+			outputs[0] = 0;
+			return true;
+		}
+		return false;
+	}
+
+	static float PoseScore(const std::vector<const float*>& outputs, const size_t pose)
+	{
+		return outputs[0][(pose * POSE_STRIDE) + 55];
+	}
+};
+
+const std::string MoveNetMultiPoseTraits::m_name{ "MoveNet multi pose" };
+
+/*
+
+	BlazePose / MediaPipe pose landmark lite, full and heavy
+	https://github.com/google/mediapipe/blob/master/docs/solutions/pose.md
+
+	input [1, 256, 256, 3] RGB 0 - 1, [1, 3, 256, 256] in NCHW conversions
+	outputs
+		landmarks [1, 195] - 33 landmarks plus 6 auxiliary ones, each x, y, z, visibility, presence with x and y in input pixels
+			visibility and presence are logits, presence means the landmark is within the frame, visibility that it's also not occluded
+		pose flag [1, 1] - logit of a pose being present
+		segmentation, heatmap and world landmarks, which we don't use
+
+*/
+
+struct BlazePoseTraits
+{
+	static constexpr size_t KEYPOINT_COUNT = 33;
+	static constexpr size_t STRIDE = 5;
+	static constexpr size_t POSE_COUNT = 1;
+	static constexpr size_t POSE_STRIDE = 0;
+	static constexpr int64_t DYNAMIC_INPUT_SIZE = 0;
+	static constexpr TensorLayout INPUT_LAYOUT = TENSOR_LAYOUT_NHWC;
+	static constexpr size_t OUTPUT_COUNT = 2;
+	static constexpr float KEYPOINT_THRESHOLD = 0.5f;
+	static constexpr float POSE_THRESHOLD = 0.5f;
+	static constexpr float NORMALIZE_DIV = 255.0f;
+	static constexpr float NORMALIZE_ADD = 0.0f;
+
+	static const std::string m_name;
+	static const std::array<int32_t, KEYPOINT_COUNT> m_keypoints;
+
+	static bool SupportsInputType(const ONNXTensorElementDataType type)
+	{
+		return type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT || type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16;
+	}
+
+	static bool MatchOutputs(const PoseModelSignature& signature, std::array<size_t, OUTPUT_COUNT>& outputs)
+	{
+		// landmark outputs come with or without the auxiliary landmarks depending on the conversion, the outputs aren't always in the same order either
+		bool landmarks = false;
+		bool poseflag = false;
+		for (size_t i = 0; i < signature.m_outputs.size(); i++)
+		{
+			const std::vector<int64_t>& shape = signature.m_outputs[i].m_shape;
+			if (shape.size() == 2 && shape[0] == 1 && (shape[1] == 195 || shape[1] == KEYPOINT_COUNT * STRIDE) && !landmarks)
+			{
+				outputs[0] = i;
+				landmarks = true;
+			}
+			else if (shape.size() == 2 && shape[0] == 1 && shape[1] == 1 && !poseflag)
+			{
+				outputs[1] = i;
+				poseflag = true;
+			}
+		}
+		return landmarks && poseflag;
+	}
+
+	static float PoseScore(const std::vector<const float*>& outputs, const size_t pose)
+	{
+		return Sigmoid(outputs[1][0]);
+	}
+
+	static float X(const float* landmark, const float inputsize)
+	{
+		return landmark[0];
+	}
+
+	static float Y(const float* landmark, const float inputsize)
+	{
+		return landmark[1];
+	}
+
+	static float Z(const float* landmark, const float inputsize)
+	{
+		return landmark[2];
+	}
+
+	static float Score(const float* landmark)
+	{
+		return Sigmoid(landmark[4]);
+	}
+};
+
+const std::string BlazePoseTraits::m_name{ "BlazePose" };
+
+const std::array<int32_t, BlazePoseTraits::KEYPOINT_COUNT> BlazePoseTraits::m_keypoints{
+	KEYPOINT_NOSE,
+	0,								// left eye inner
+	KEYPOINT_LEFT_EYE_CENTER,
+	0,								// left eye outer
+	0,								// right eye inner
+	KEYPOINT_RIGHT_EYE_CENTER,
+	0,								// right eye outer
+	KEYPOINT_LEFT_EAR,
+	KEYPOINT_RIGHT_EAR,
+	0,								// mouth left
+	0,								// mouth right
+	KEYPOINT_LEFT_SHOULDER,
+	KEYPOINT_RIGHT_SHOULDER,
+	KEYPOINT_LEFT_ELBOW,
+	KEYPOINT_RIGHT_ELBOW,
+	KEYPOINT_LEFT_WRIST,
+	KEYPOINT_RIGHT_WRIST,
+	0,								// left pinky
+	0,								// right pinky
+	0,								// left index
+	0,								// right index
+	0,								// left thumb
+	0,								// right thumb
+	KEYPOINT_LEFT_HIP,
+	KEYPOINT_RIGHT_HIP,
+	KEYPOINT_LEFT_KNEE,
+	KEYPOINT_RIGHT_KNEE,
+	KEYPOINT_LEFT_ANKLE,
+	KEYPOINT_RIGHT_ANKLE,
+	0,								// left heel
+	0,								// right heel
+	0,								// left foot index
+	0 };							// right foot index
+
+template<typename Traits>
+class PoseModelAdapterT :public PoseModelAdapter
+{
+public:
+
+	static std::unique_ptr<PoseModelAdapter> Create(const PoseModelSignature& signature)
+	{
+		if (signature.m_inputs.size() != 1)
+		{
+			return nullptr;
+		}
+
+		// [1, height, width, 3] or [1, 3, height, width]
+		const std::vector<int64_t>& shape = signature.m_inputs[0].m_shape;
+		if (shape.size() != 4 || (shape[3] != 3 && shape[1] != 3))
+		{
+			return nullptr;
+		}
+
+		TensorLayout layout = Traits::INPUT_LAYOUT;
+		if ((shape[3] == 3) != (shape[1] == 3))
+		{
+			layout = (shape[3] == 3) ? TENSOR_LAYOUT_NHWC : TENSOR_LAYOUT_NCHW;
+		}
+		const int64_t height = (layout == TENSOR_LAYOUT_NHWC) ? shape[1] : shape[2];
+		const int64_t width = (layout == TENSOR_LAYOUT_NHWC) ? shape[2] : shape[3];
+
+		int64_t inputsize = height;
+		if (height <= 0 && width <= 0 && Traits::DYNAMIC_INPUT_SIZE > 0)
+		{
+			inputsize = Traits::DYNAMIC_INPUT_SIZE;
+		}
+		else if (height != width || height <= 0)
+		{
+			return nullptr;
+		}
+
+		std::array<size_t, Traits::OUTPUT_COUNT> outputs;
+		if (!Traits::MatchOutputs(signature, outputs))
+		{
+			return nullptr;
+		}
+
+		return std::unique_ptr<PoseModelAdapter>(new PoseModelAdapterT<Traits>(inputsize, layout, outputs));
+	}
+
+	const std::string& Name() const
+	{
+		return Traits::m_name;
+	}
+
+	int64_t InputSize() const
+	{
+		return m_inputsize;
+	}
+
+	TensorLayout InputLayout() const
+	{
+		return m_inputlayout;
+	}
+
+	size_t MaxPoses() const
+	{
+		return Traits::POSE_COUNT;
+	}
+
+	bool SupportsInputType(const ONNXTensorElementDataType type) const
+	{
+		return Traits::SupportsInputType(type);
+	}
+
+	float NormalizeDiv() const
+	{
+		return Traits::NORMALIZE_DIV;
+	}
+
+	float NormalizeAdd() const
+	{
+		return Traits::NORMALIZE_ADD;
+	}
+
+	const std::vector<size_t>& Outputs() const
+	{
+		return m_outputs;
+	}
+
+	void Decode(const std::vector<const float*>& outputs, const PoseModelInputTransform& transform, std::vector<PoseDetection>& poses) const
+	{
+		const float inputsize = static_cast<float>(m_inputsize);
+
+		for (size_t p = 0; p < Traits::POSE_COUNT; p++)
+		{
+			const float posescore = Traits::PoseScore(outputs, p);
+			const bool pose = posescore >= Traits::POSE_THRESHOLD;
+			if (!pose && Traits::POSE_COUNT > 1)
+			{
+				continue;
+			}
+
+			poses.push_back(PoseDetection());
+			PoseDetection& posedetection = poses.back();
+			posedetection.m_score = posescore;
+
+			const float* landmark = outputs[0] + (p * Traits::POSE_STRIDE);
+			for (size_t i = 0; i < Traits::KEYPOINT_COUNT; i++, landmark += Traits::STRIDE)
+			{
+				if (Traits::m_keypoints[i] == 0)
+				{
+					continue;
+				}
+
+				KeypointDetection& keypoint = posedetection.m_keypoints[Traits::m_keypoints[i]];
+				keypoint.m_pos.m_x = (Traits::X(landmark, inputsize) * transform.m_scale) + transform.m_offsetx;
+				keypoint.m_pos.m_y = (Traits::Y(landmark, inputsize) * transform.m_scale) + transform.m_offsety;
+				keypoint.m_pos.m_z = Traits::Z(landmark, inputsize) * transform.m_scale;
+				keypoint.m_score = pose ? Traits::Score(landmark) : 0.0f;
+				if (keypoint.m_score > Traits::KEYPOINT_THRESHOLD)
+				{
+					keypoint.m_presence = KEYPOINT_PRESENCE_PRESENT;
+				}
+			}
+		}
+	}
+
+private:
+
+	PoseModelAdapterT(const int64_t inputsize, const TensorLayout inputlayout, const std::array<size_t, Traits::OUTPUT_COUNT>& outputs) :PoseModelAdapter(), m_inputsize(inputsize), m_inputlayout(inputlayout), m_outputs(outputs.begin(), outputs.end())
+	{
+
+	}
+
+	int64_t m_inputsize;
+	TensorLayout m_inputlayout;
+	std::vector<size_t> m_outputs;
+
+};
+
+// adapters are tried in order, the first one that matches the model is used
+typedef std::unique_ptr<PoseModelAdapter>(*CreateAdapterFunction)(const PoseModelSignature&);
+const std::array<CreateAdapterFunction, 3> AdapterRegistry{
+	&PoseModelAdapterT<MoveNetTraits>::Create,
+	&PoseModelAdapterT<MoveNetMultiPoseTraits>::Create,
+	&PoseModelAdapterT<BlazePoseTraits>::Create };
+
+}
+
+std::string TensorElementTypeName(const ONNXTensorElementDataType type)
+{
+	switch (type)
+	{
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+		return "float";
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+		return "float16";
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+		return "uint8";
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+		return "int8";
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+		return "int32";
+	default:
+		return "type " + std::to_string(static_cast<int32_t>(type));
+	}
+}
+
+int64_t TensorSignature::ElementCount() const
+{
+	int64_t count = 1;
+	for (std::vector<int64_t>::const_iterator d = m_shape.begin(); d != m_shape.end(); d++)
+	{
+		count = ((*d) > 0 && count > 0) ? count * (*d) : -1;
+	}
+	return count;
+}
+
+PoseModelAdapter::PoseModelAdapter()
+{
+
+}
+
+PoseModelAdapter::~PoseModelAdapter()
+{
+
+}
+
+std::unique_ptr<PoseModelAdapter> PoseModelAdapter::Create(const PoseModelSignature& signature)
+{
+	for (std::array<CreateAdapterFunction, 3>::const_iterator i = AdapterRegistry.begin(); i != AdapterRegistry.end(); i++)
+	{
+		std::unique_ptr<PoseModelAdapter> adapter = (*i)(signature);
+		if (adapter)
+		{
+			return adapter;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+#include "posekeypointdata.h"
+#include "preprocessfunctions.h"
+
+struct TensorSignature
+{
+	std::string m_name{ "" };
+	ONNXTensorElementDataType m_type{ ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED };
+	std::vector<int64_t> m_shape;
+
+	int64_t ElementCount() const;		// -1 if any dimension isn't fixed
+};
+
+std::string TensorElementTypeName(const ONNXTensorElementDataType type);
+
+struct PoseModelSignature
+{
+	std::vector<TensorSignature> m_inputs;
+	std::vector<TensorSignature> m_outputs;
+};
+
+// maps a point in the model input back to the camera image
+struct PoseModelInputTransform
+{
+	float m_scale{ 1.0 };
+	float m_offsetx{ 0.0 };
+	float m_offsety{ 0.0 };
+};
+
+/*
+
+	Everything that differs between pose models - input layout and normalization, which outputs hold the landmarks and how to decode them into our keypoints
+	The adapter for a model is picked from the model's input and output signatures
+
+*/
+
+class PoseModelAdapter
+{
+public:
+	virtual ~PoseModelAdapter();
+
+	// returns nullptr if no adapter recognizes the model
+	static std::unique_ptr<PoseModelAdapter> Create(const PoseModelSignature& signature);
+
+	virtual const std::string& Name() const = 0;
+
+	// square RGB input, NHWC or NCHW as found in the model's input shape
+	virtual int64_t InputSize() const = 0;
+	virtual TensorLayout InputLayout() const = 0;
+	virtual size_t MaxPoses() const = 0;
+	virtual bool SupportsInputType(const ONNXTensorElementDataType type) const = 0;
+
+	// channel values are divided by div then add is added, for float inputs
+	virtual float NormalizeDiv() const = 0;
+	virtual float NormalizeAdd() const = 0;
+
+	// outputs Decode needs, in the order it expects their data
+	virtual const std::vector<size_t>& Outputs() const = 0;
+
+	// adds a pose for every person found, single pose models always add one
+	virtual void Decode(const std::vector<const float*>& outputs, const PoseModelInputTransform& transform, std::vector<PoseDetection>& poses) const = 0;
+
+protected:
+	PoseModelAdapter();
+
+};
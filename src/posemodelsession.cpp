@@ -0,0 +1,393 @@
+#include "posemodelsession.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "global.h"
+#include "onnxquantization.h"
+#include "opencvfunctions.h"
+
+PoseModelSession::PoseModelSession(Ort::Env& env, const PoseModelSessionOptions& options) :m_modelfile(), m_session(CreateSession(env, options, m_modelfile)), m_binding(m_session), m_memoryinfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
+	m_inputtype(ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED), m_inputsize(256), m_inputlayout(TENSOR_LAYOUT_NHWC), m_hasdynamicoutputs(false), m_useuint8lut(false), m_posediv(options.m_posediv), m_poseadd(options.m_poseadd)
+{
+	Ort::AllocatorWithDefaultOptions allocator;
+
+	for (size_t i = 0; i < m_session.GetInputCount(); i++)
+	{
+		TensorSignature input;
+		input.m_name = m_session.GetInputNameAllocated(i, allocator).get();
+		input.m_type = m_session.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetElementType();
+		input.m_shape = m_session.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+		m_signature.m_inputs.push_back(input);
+	}
+
+	for (size_t i = 0; i < m_session.GetOutputCount(); i++)
+	{
+		TensorSignature output;
+		output.m_name = m_session.GetOutputNameAllocated(i, allocator).get();
+		output.m_type = m_session.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetElementType();
+		output.m_shape = m_session.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+		m_signature.m_outputs.push_back(output);
+	}
+
+	m_adapter = PoseModelAdapter::Create(m_signature);
+	if (!m_adapter)
+	{
+		throw std::runtime_error("ONNX model " + options.m_onnxmodel + " is not a supported pose model");
+	}
+
+	m_inputtype = m_signature.m_inputs[0].m_type;
+	m_inputsize = m_adapter->InputSize();
+	m_inputlayout = m_adapter->InputLayout();
+	if (!m_adapter->SupportsInputType(m_inputtype))
+	{
+		throw std::runtime_error("ONNX model " + options.m_onnxmodel + " input type " + TensorElementTypeName(m_inputtype) + " is not supported for " + m_adapter->Name());
+	}
+
+	if (!options.m_posenormalizeoverride)
+	{
+		m_posediv = m_adapter->NormalizeDiv();
+		m_poseadd = m_adapter->NormalizeAdd();
+	}
+	m_useuint8lut = BuildNormalizeLUT(m_uint8lut, m_posediv, m_poseadd);
+	if (m_inputtype == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8)
+	{
+		// the normalized value is quantized the way the model dequantizes its input
+		float scale = 1.0f;
+		int32_t zeropoint = 0;
+		const std::shared_ptr<MappedFile> model = OpenModelFile(options, options.m_onnxmodel);
+		if (!FindInputQuantization(model->Data(), model->Size(), m_signature.m_inputs[0].m_name, scale, zeropoint))
+		{
+			throw std::runtime_error("ONNX model " + options.m_onnxmodel + " has an int8 input without a per tensor DequantizeLinear, its scale and zero point are unknown");
+		}
+		std::cout << "Pose model input is quantized with scale " << scale << " and zero point " << zeropoint << std::endl;
+		BuildQuantizeLUT(m_uint8lut, m_posediv, m_poseadd, scale, zeropoint);
+		m_useuint8lut = true;
+	}
+
+	for (std::vector<size_t>::const_iterator i = m_adapter->Outputs().begin(); i != m_adapter->Outputs().end(); i++)
+	{
+		const ONNXTensorElementDataType type = m_signature.m_outputs[(*i)].m_type;
+		if (type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT && type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16)
+		{
+			throw std::runtime_error("ONNX model " + options.m_onnxmodel + " output " + m_signature.m_outputs[(*i)].m_name + " type " + TensorElementTypeName(type) + " is not supported");
+		}
+	}
+
+	std::cout << "Pose model " << options.m_onnxmodel << " is " << m_adapter->Name() << " with a " << m_inputsize << " x " << m_inputsize << " " << TensorLayoutName[m_inputlayout] << " " << TensorElementTypeName(m_inputtype) << " input" << std::endl;
+
+	BindInput();
+	BindOutputs();
+	m_outputdata.assign(m_adapter->Outputs().size(), nullptr);
+	Warmup();
+}
+
+PoseModelSession::~PoseModelSession()
+{
+
+}
+
+Ort::SessionOptions PoseModelSession::CreateSessionOptions(const PoseModelSessionOptions& options, const bool preoptimized)
+{
+	Ort::SessionOptions session_options;
+	session_options.SetGraphOptimizationLevel(preoptimized ? GraphOptimizationLevel::ORT_DISABLE_ALL : GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+	session_options.SetExecutionMode(options.m_parallelexecution ? ExecutionMode::ORT_PARALLEL : ExecutionMode::ORT_SEQUENTIAL);
+
+	if (options.m_useglobalthreadpool)
+	{
+		session_options.DisablePerSessionThreads();
+	}
+	else
+	{
+		session_options.SetIntraOpNumThreads(options.m_intraopthreads);
+		session_options.SetInterOpNumThreads(options.m_interopthreads);
+		if (!options.m_threadspinning)
+		{
+			session_options.AddConfigEntry("session.intra_op.allow_spinning", "0");
+			session_options.AddConfigEntry("session.inter_op.allow_spinning", "0");
+		}
+		if (!options.m_threadaffinity.empty())
+		{
+			session_options.AddConfigEntry("session.intra_op_thread_affinities", options.m_threadaffinity.c_str());
+		}
+	}
+
+	AppendExecutionProvider(session_options, options.m_executionprovider, options.m_executionprovideroptions);
+
+	return session_options;
+}
+
+Ort::Session PoseModelSession::CreateSession(Ort::Env& env, const PoseModelSessionOptions& options, std::shared_ptr<MappedFile>& modelfile)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	const std::shared_ptr<MappedFile> model = OpenModelFile(options, options.m_onnxmodel);
+
+	// an ORT format model is already optimized and can't be cached again
+	if (!options.m_modelcachedir.empty() && std::filesystem::path(options.m_onnxmodel).extension() != ".ort")
+	{
+		const std::string cachedmodel = GetCachedModelPath(options, *model);
+
+		if (std::filesystem::exists(cachedmodel))
+		{
+			try
+			{
+				Ort::SessionOptions session_options = CreateSessionOptions(options, true);
+				Ort::Session session = CreateSession(env, OpenModelFile(options, cachedmodel), session_options, modelfile);
+				std::cout << "Loaded cached optimized model " << cachedmodel << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+				return session;
+			}
+			catch (std::exception& e)
+			{
+				std::cout << "Cached optimized model " << cachedmodel << " could not be loaded, rebuilding it - " << e.what() << std::endl;
+			}
+		}
+
+		// ORT writes the optimized graph while creating the session
+		// this fails for providers that compile the graph into their own nodes, in which case we run without the cache
+		try
+		{
+			std::filesystem::create_directories(options.m_modelcachedir);
+			Ort::SessionOptions session_options = CreateSessionOptions(options, false);
+			session_options.SetOptimizedModelFilePath(ToORTPath(cachedmodel).c_str());
+			Ort::Session session = CreateSession(env, model, session_options, modelfile);
+			std::cout << "Optimized model " << options.m_onnxmodel << " and cached it as " << cachedmodel << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+			return session;
+		}
+		catch (std::exception& e)
+		{
+			std::error_code ec;
+			std::filesystem::remove(cachedmodel, ec);
+			std::cout << "Optimized model could not be cached - " << e.what() << std::endl;
+		}
+	}
+
+	Ort::SessionOptions session_options = CreateSessionOptions(options, false);
+	return CreateSession(env, model, session_options, modelfile);
+}
+
+Ort::Session PoseModelSession::CreateSession(Ort::Env& env, const std::shared_ptr<MappedFile>& model, Ort::SessionOptions& session_options, std::shared_ptr<MappedFile>& modelfile)
+{
+	// ORT copies the weights out of an ONNX model while building the session, so the mapping can go once we're done
+	// the weights of an ORT format model are used in place and the mapping has to live as long as the session
+	if (std::filesystem::path(model->Path()).extension() == ".ort")
+	{
+		session_options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+		session_options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+		modelfile = model;
+	}
+
+	return Ort::Session(env, model->Data(), model->Size(), session_options);
+}
+
+std::shared_ptr<MappedFile> PoseModelSession::OpenModelFile(const PoseModelSessionOptions& options, const std::string& path)
+{
+	// ORT copies what it needs out of an ONNX model, so the mapping would be gone before the next session is built unless someone keeps it
+	const std::shared_ptr<MappedFile> file = MappedFile::Open(path, options.m_sharemodelmapping);
+	if (options.m_sharemodelmapping && options.m_mappings && std::find(options.m_mappings->begin(), options.m_mappings->end(), file) == options.m_mappings->end())
+	{
+		options.m_mappings->push_back(file);
+	}
+	return file;
+}
+
+std::string PoseModelSession::GetCachedModelPath(const PoseModelSessionOptions& options, const MappedFile& model)
+{
+	// the optimized graph depends on the model, the execution provider and its options, and the ORT version doing the optimizing
+	uint64_t hash = global::HashFNV1a(model.Data(), model.Size());
+
+	std::ostringstream key;
+	key << ExecutionProviderName[options.m_executionprovider];
+	for (ExecutionProviderOptions::const_iterator i = options.m_executionprovideroptions.begin(); i != options.m_executionprovideroptions.end(); i++)
+	{
+		key << ";" << (*i).first << "=" << (*i).second;
+	}
+	key << ";" << Ort::GetVersionString();
+	hash = global::HashFNV1a(key.str().data(), key.str().size(), hash);
+
+	std::ostringstream filename;
+	filename << std::filesystem::path(options.m_onnxmodel).stem().string() << "-" << std::hex << std::setw(16) << std::setfill('0') << hash << ".onnx";
+	return (std::filesystem::path(options.m_modelcachedir) / filename.str()).string();
+}
+
+std::basic_string<ORTCHAR_T> PoseModelSession::ToORTPath(const std::string& path)
+{
+#ifdef _WIN32
+	std::wstring pathwc{ L"" };
+	global::MultiByteToWideCharString(path, pathwc);
+	return pathwc;
+#else
+	return path;
+#endif
+}
+
+void PoseModelSession::Warmup()
+{
+	// the first run allocates and initializes everything the session needs, get that out of the way before the first frame arrives
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_session.Run(Ort::RunOptions{ nullptr }, m_binding);
+	std::cout << "Pose model warm up took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+}
+
+void PoseModelSession::BindInput()
+{
+	// batch size, height, width, channels or batch size, channels, height, width
+	const std::array<int64_t, 4> input_node_dim = (m_inputlayout == TENSOR_LAYOUT_NCHW) ? std::array<int64_t, 4>{ 1, 3, m_inputsize, m_inputsize } : std::array<int64_t, 4>{ 1, m_inputsize, m_inputsize, 3 };
+	const size_t count = static_cast<size_t>(m_inputsize * m_inputsize * 3LL);
+
+	void* data = nullptr;
+	size_t bytes = 0;
+	switch (m_inputtype)
+	{
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+		m_floatinput.assign(count, 0);
+		data = m_floatinput.data();
+		bytes = count * sizeof(float);
+		break;
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+		m_floatinput.assign(count, 0);
+		m_halfinput.assign(count, 0);
+		data = m_halfinput.data();
+		bytes = count * sizeof(uint16_t);
+		break;
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+		m_uint8input.assign(count, 0);
+		data = m_uint8input.data();
+		bytes = count * sizeof(uint8_t);
+		break;
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+		m_uint8input.assign(count, 0);
+		m_int32input.assign(count, 0);
+		data = m_int32input.data();
+		bytes = count * sizeof(int32_t);
+		break;
+	default:
+		throw std::runtime_error("Pose model input type " + TensorElementTypeName(m_inputtype) + " is not supported");
+	}
+
+	m_inputtensors.clear();
+	m_inputtensors.push_back(Ort::Value::CreateTensor(m_memoryinfo, data, bytes, input_node_dim.data(), input_node_dim.size(), m_inputtype));
+	m_binding.BindInput(m_signature.m_inputs[0].m_name.c_str(), m_inputtensors[0]);
+}
+
+void PoseModelSession::BindOutputs()
+{
+	m_outputbuffers.assign(m_signature.m_outputs.size(), std::vector<float>());
+	m_halfoutputs.assign(m_signature.m_outputs.size(), std::vector<uint16_t>());
+	m_outputtensors.clear();
+	m_hasdynamicoutputs = false;
+
+	for (size_t i = 0; i < m_signature.m_outputs.size(); i++)
+	{
+		const TensorSignature& output = m_signature.m_outputs[i];
+		const int64_t count = output.ElementCount();
+
+		if (output.m_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT && count > 0)
+		{
+			m_outputbuffers[i].assign(count, 0);
+			m_outputtensors.push_back(Ort::Value::CreateTensor<float>(m_memoryinfo, m_outputbuffers[i].data(), m_outputbuffers[i].size(), output.m_shape.data(), output.m_shape.size()));
+			m_binding.BindOutput(output.m_name.c_str(), m_outputtensors.back());
+		}
+		else if (output.m_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 && count > 0)
+		{
+			m_halfoutputs[i].assign(count, 0);
+			m_outputbuffers[i].assign(count, 0);
+			m_outputtensors.push_back(Ort::Value::CreateTensor(m_memoryinfo, m_halfoutputs[i].data(), m_halfoutputs[i].size() * sizeof(uint16_t), output.m_shape.data(), output.m_shape.size(), output.m_type));
+			m_binding.BindOutput(output.m_name.c_str(), m_outputtensors.back());
+		}
+		else
+		{
+			// dynamic shape - let ORT allocate the output
+			m_binding.BindOutput(output.m_name.c_str(), m_memoryinfo);
+			m_hasdynamicoutputs = true;
+		}
+	}
+}
+
+const float* PoseModelSession::OutputData(const size_t output)
+{
+	if (m_signature.m_outputs[output].m_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16)
+	{
+		const bool fixed = !m_halfoutputs[output].empty();
+		const uint16_t* half = fixed ? m_halfoutputs[output].data() : m_dynamicoutputs[output].GetTensorData<uint16_t>();
+		const size_t count = fixed ? m_halfoutputs[output].size() : m_dynamicoutputs[output].GetTensorTypeAndShapeInfo().GetElementCount();
+		m_outputbuffers[output].resize(count);
+		HalfToFloat(half, m_outputbuffers[output].data(), static_cast<int64_t>(count));
+		return m_outputbuffers[output].data();
+	}
+	if (!m_outputbuffers[output].empty())
+	{
+		return m_outputbuffers[output].data();
+	}
+	return m_dynamicoutputs[output].GetTensorData<float>();
+}
+
+void PoseModelSession::Detect(const cv::Mat& img, std::vector<PoseDetection>& poses)
+{
+	int32_t cropx = 0;
+	int32_t cropy = 0;
+	int32_t cropsize = 0;
+	GetCenterCrop(img.cols, img.rows, cropx, cropy, cropsize);
+	Detect(img, cropx, cropy, cropsize, poses);
+}
+
+void PoseModelSession::Detect(const cv::Mat& img, const int32_t cropx, const int32_t cropy, const int32_t cropsize, std::vector<PoseDetection>& poses)
+{
+	// crop, resize, swap channels and normalize straight into the input tensor in the model's layout
+	m_preprocessor.SetGeometry(img.cols, img.rows, cropx, cropy, cropsize, static_cast<int32_t>(m_inputsize), IsYUYVImage(img) ? PIXEL_FORMAT_YUYV : PIXEL_FORMAT_BGR, m_inputlayout);
+	const int32_t imageoffsetx = m_preprocessor.CropX();
+	const int32_t imageoffsety = m_preprocessor.CropY();
+	const float imagescale = m_preprocessor.Scale();
+
+	switch (m_inputtype)
+	{
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+		m_preprocessor.Process(img.data, static_cast<int64_t>(img.step), m_floatinput.data(), 1.0f / m_posediv, m_poseadd);
+		break;
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+		m_preprocessor.Process(img.data, static_cast<int64_t>(img.step), m_floatinput.data(), 1.0f / m_posediv, m_poseadd);
+		FloatToHalf(m_floatinput.data(), m_halfinput.data(), static_cast<int64_t>(m_halfinput.size()));
+		break;
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+		m_preprocessor.Process(img.data, static_cast<int64_t>(img.step), m_uint8input.data(), m_useuint8lut ? m_uint8lut.data() : nullptr);
+		break;
+	case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+		m_preprocessor.Process(img.data, static_cast<int64_t>(img.step), m_uint8input.data(), m_useuint8lut ? m_uint8lut.data() : nullptr);
+		std::copy(m_uint8input.begin(), m_uint8input.end(), m_int32input.begin());
+		break;
+	default:
+		break;
+	}
+
+	m_session.Run(Ort::RunOptions{ nullptr }, m_binding);
+
+	// ORT allocates dynamic outputs on every run, the values are fetched once and the pointers taken from them
+	if (m_hasdynamicoutputs)
+	{
+		m_dynamicoutputs = m_binding.GetOutputValues();
+	}
+
+	for (size_t i = 0; i < m_outputdata.size(); i++)
+	{
+		m_outputdata[i] = OutputData(m_adapter->Outputs()[i]);
+	}
+
+	PoseModelInputTransform transform;
+	transform.m_scale = imagescale;
+	transform.m_offsetx = static_cast<float>(imageoffsetx);
+	transform.m_offsety = static_cast<float>(imageoffsety);
+	poses.clear();
+	m_adapter->Decode(m_outputdata, transform, poses);
+}
+
+int64_t PoseModelSession::InputSize() const
+{
+	return m_inputsize;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+#include <opencv2/core/mat.hpp>
+
+#include "executionprovider.h"
+#include "mappedfile.h"
+#include "posemodeladapter.h"
+#include "posekeypointdata.h"
+#include "preprocessfunctions.h"
+
+struct PoseModelSessionOptions
+{
+	std::string m_onnxmodel{ "" };
+	ExecutionProvider m_executionprovider{ EXECUTION_PROVIDER_CPU };
+	ExecutionProviderOptions m_executionprovideroptions;
+
+	// threading
+	int32_t m_intraopthreads{ 1 };				// 0 lets ORT decide
+	int32_t m_interopthreads{ 0 };
+	bool m_parallelexecution{ false };
+	bool m_threadspinning{ true };
+	std::string m_threadaffinity{ "" };			// ORT affinity string, e.g. "1;2;3" for 4 intra op threads
+	bool m_useglobalthreadpool{ false };		// env was created with global thread pools, all thread settings above come from the env
+
+	std::string m_modelcachedir{ "" };			// optimized models are saved here and loaded on later runs, empty to disable
+	bool m_sharemodelmapping{ true };			// sessions loading the same model file use one memory mapping
+	std::vector<std::shared_ptr<MappedFile>>* m_mappings{ nullptr };	// with m_sharemodelmapping every file the session maps is added here, the caller keeps them so the next session reuses the mapping
+
+	//debug
+	bool m_posenormalizeoverride{ false };		// use m_posediv and m_poseadd instead of the model adapter's normalization
+	float m_posediv{ 1.0 };
+	float m_poseadd{ 0.0 };
+};
+
+/*
+
+	One ONNX Runtime session for a pose model
+	A PoseModelAdapter picked from the model's signature supplies the input size, normalization and output decoding
+	The model file is memory mapped and handed to ORT as a buffer, ORT format models (.ort) use the mapped bytes directly for their weights
+	Input and output tensors are allocated and bound once with an IoBinding, every inference reuses the same buffers
+
+*/
+
+class PoseModelSession
+{
+public:
+	PoseModelSession(Ort::Env& env, const PoseModelSessionOptions& options);
+	~PoseModelSession();
+
+	// runs the model on the center crop of a BGR image and replaces poses with the people found, keypoints are in image coordinates
+	void Detect(const cv::Mat& img, std::vector<PoseDetection>& poses);
+	// same on a square crop in image pixels, which may extend past the image edges
+	void Detect(const cv::Mat& img, const int32_t cropx, const int32_t cropy, const int32_t cropsize, std::vector<PoseDetection>& poses);
+
+	int64_t InputSize() const;
+
+private:
+
+	static Ort::SessionOptions CreateSessionOptions(const PoseModelSessionOptions& options, const bool preoptimized);
+	static Ort::Session CreateSession(Ort::Env& env, const PoseModelSessionOptions& options, std::shared_ptr<MappedFile>& modelfile);
+	static Ort::Session CreateSession(Ort::Env& env, const std::shared_ptr<MappedFile>& model, Ort::SessionOptions& session_options, std::shared_ptr<MappedFile>& modelfile);
+	static std::shared_ptr<MappedFile> OpenModelFile(const PoseModelSessionOptions& options, const std::string& path);
+	static std::string GetCachedModelPath(const PoseModelSessionOptions& options, const MappedFile& model);
+	static std::basic_string<ORTCHAR_T> ToORTPath(const std::string& path);
+
+	void Warmup();
+
+	void BindInput();
+	void BindOutputs();
+	const float* OutputData(const size_t output);
+
+	std::shared_ptr<MappedFile> m_modelfile;		// only kept when the session uses the mapped bytes directly
+	Ort::Session m_session;
+	Ort::IoBinding m_binding;
+	Ort::MemoryInfo m_memoryinfo;
+
+	PoseModelSignature m_signature;
+	std::unique_ptr<PoseModelAdapter> m_adapter;
+	ONNXTensorElementDataType m_inputtype;
+	int64_t m_inputsize;
+	TensorLayout m_inputlayout;
+
+	// the input tensor is bound to the buffer matching the model's input type, float and uint8 are also used as scratch for FP16 and INT32 inputs
+	std::vector<float> m_floatinput;
+	std::vector<uint8_t> m_uint8input;			// also INT8 inputs, the lut quantizes them with the model's scale and zero point
+	std::vector<uint16_t> m_halfinput;
+	std::vector<int32_t> m_int32input;
+	std::vector<std::vector<float>> m_outputbuffers;		// empty when the output shape isn't fixed, ORT allocates those, FP16 outputs are converted into them after every run
+	std::vector<std::vector<uint16_t>> m_halfoutputs;		// bound FP16 outputs with a fixed shape
+	std::vector<Ort::Value> m_inputtensors;
+	std::vector<Ort::Value> m_outputtensors;
+	std::vector<Ort::Value> m_dynamicoutputs;				// every output after the last run, only fetched when one of them has a dynamic shape
+	bool m_hasdynamicoutputs;
+	std::vector<const float*> m_outputdata;					// outputs the adapter decodes, in adapter order
+
+	CropResizePreprocessor m_preprocessor;
+	std::array<uint8_t, 256> m_uint8lut;
+	bool m_useuint8lut;
+
+	//debug
+	float m_posediv;
+	float m_poseadd;
+
+};
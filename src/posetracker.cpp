@@ -0,0 +1,236 @@
+#include "posetracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+std::array<std::string, PoseSubject::POSE_SUBJECT_MAX> PoseSubjectName{ "largest","center","pinned" };
+
+bool GetPoseSubject(const std::string& name, PoseSubject& subject, int32_t& pinnedid)
+{
+	pinnedid = -1;
+	if (name == PoseSubjectName[POSE_SUBJECT_LARGEST])
+	{
+		subject = POSE_SUBJECT_LARGEST;
+		return true;
+	}
+	if (name == PoseSubjectName[POSE_SUBJECT_CENTER])
+	{
+		subject = POSE_SUBJECT_CENTER;
+		return true;
+	}
+
+	try
+	{
+		size_t end = 0;
+		pinnedid = std::stoi(name, &end);
+		if (end == name.size() && pinnedid > 0)
+		{
+			subject = POSE_SUBJECT_PINNED;
+			return true;
+		}
+	}
+	catch (std::exception&)
+	{
+	}
+	pinnedid = -1;
+	return false;
+}
+
+PoseTracker::PoseTracker() :m_subject(POSE_SUBJECT_LARGEST), m_pinnedid(-1), m_subjectid(-1), m_nextid(1)
+{
+
+}
+
+PoseTracker::~PoseTracker()
+{
+
+}
+
+void PoseTracker::Configure(const PoseSubject subject, const int32_t pinnedid)
+{
+	m_subject = subject;
+	m_pinnedid = pinnedid;
+	m_subjectid = (subject == POSE_SUBJECT_PINNED) ? pinnedid : -1;
+	m_nextid = 1;
+	m_tracks.clear();
+}
+
+int32_t PoseTracker::Update(std::vector<PoseDetection>& poses, const int32_t width, const int32_t height)
+{
+	std::vector<Box> boxes(poses.size());
+	std::vector<bool> hasbox(poses.size(), false);
+	for (size_t i = 0; i < poses.size(); i++)
+	{
+		hasbox[i] = GetBox(poses[i], boxes[i]);
+		poses[i].m_id = -1;
+	}
+
+	// greedy matching, most similar pair first
+	struct Match
+	{
+		float m_similarity;
+		size_t m_track;
+		size_t m_pose;
+	};
+	std::vector<Match> matches;
+	for (size_t t = 0; t < m_tracks.size(); t++)
+	{
+		for (size_t p = 0; p < poses.size(); p++)
+		{
+			if (hasbox[p])
+			{
+				const float similarity = Similarity(m_tracks[t], poses[p], boxes[p]);
+				if (similarity >= MIN_SIMILARITY)
+				{
+					matches.push_back(Match{ similarity, t, p });
+				}
+			}
+		}
+	}
+	std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.m_similarity > b.m_similarity; });
+
+	std::vector<bool> trackmatched(m_tracks.size(), false);
+	for (std::vector<Match>::const_iterator i = matches.begin(); i != matches.end(); i++)
+	{
+		if (!trackmatched[(*i).m_track] && poses[(*i).m_pose].m_id < 0)
+		{
+			Track& track = m_tracks[(*i).m_track];
+			track.m_missed = 0;
+			track.m_box = boxes[(*i).m_pose];
+			track.m_pose = poses[(*i).m_pose];
+			poses[(*i).m_pose].m_id = track.m_id;
+			trackmatched[(*i).m_track] = true;
+		}
+	}
+
+	for (size_t t = 0; t < m_tracks.size(); t++)
+	{
+		if (!trackmatched[t])
+		{
+			m_tracks[t].m_missed++;
+		}
+	}
+	m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(), [](const Track& track) { return track.m_missed > MAX_MISSED; }), m_tracks.end());
+
+	// anyone new starts a track
+	for (size_t p = 0; p < poses.size(); p++)
+	{
+		if (poses[p].m_id < 0 && hasbox[p])
+		{
+			Track track;
+			track.m_id = m_nextid++;
+			track.m_box = boxes[p];
+			track.m_pose = poses[p];
+			m_tracks.push_back(track);
+			poses[p].m_id = track.m_id;
+		}
+	}
+
+	// keep the current subject while it's visible
+	for (size_t p = 0; p < poses.size(); p++)
+	{
+		if (m_subjectid >= 0 && poses[p].m_id == m_subjectid)
+		{
+			return static_cast<int32_t>(p);
+		}
+	}
+	if (m_subject == POSE_SUBJECT_PINNED)
+	{
+		return -1;
+	}
+
+	int32_t best = -1;
+	float bestvalue = 0;
+	for (size_t p = 0; p < poses.size(); p++)
+	{
+		if (!hasbox[p])
+		{
+			continue;
+		}
+
+		float value = 0;
+		if (m_subject == POSE_SUBJECT_CENTER)
+		{
+			const float dx = ((boxes[p].m_x0 + boxes[p].m_x1) / 2.0f) - (static_cast<float>(width) / 2.0f);
+			const float dy = ((boxes[p].m_y0 + boxes[p].m_y1) / 2.0f) - (static_cast<float>(height) / 2.0f);
+			value = -std::sqrt((dx * dx) + (dy * dy));
+		}
+		else
+		{
+			value = boxes[p].Area();
+		}
+
+		if (best < 0 || value > bestvalue)
+		{
+			best = static_cast<int32_t>(p);
+			bestvalue = value;
+		}
+	}
+
+	const int32_t subjectid = (best >= 0) ? poses[best].m_id : -1;
+	if (subjectid >= 0 && subjectid != m_subjectid)
+	{
+		std::cout << "Following person " << subjectid << " at " << static_cast<int32_t>((boxes[best].m_x0 + boxes[best].m_x1) / 2.0f) << "," << static_cast<int32_t>((boxes[best].m_y0 + boxes[best].m_y1) / 2.0f) << std::endl;
+	}
+	m_subjectid = subjectid;
+	return best;
+}
+
+bool PoseTracker::GetBox(const PoseDetection& pose, Box& box)
+{
+	bool found = false;
+	for (std::array<KeypointDetection, KEYPOINT_MAX>::const_iterator i = pose.m_keypoints.begin(); i != pose.m_keypoints.end(); i++)
+	{
+		if ((*i).m_presence == KEYPOINT_PRESENCE_PRESENT)
+		{
+			box.m_x0 = found ? std::min(box.m_x0, (*i).m_pos.m_x) : (*i).m_pos.m_x;
+			box.m_y0 = found ? std::min(box.m_y0, (*i).m_pos.m_y) : (*i).m_pos.m_y;
+			box.m_x1 = found ? std::max(box.m_x1, (*i).m_pos.m_x) : (*i).m_pos.m_x;
+			box.m_y1 = found ? std::max(box.m_y1, (*i).m_pos.m_y) : (*i).m_pos.m_y;
+			found = true;
+		}
+	}
+	return found;
+}
+
+float PoseTracker::Similarity(const Track& track, const PoseDetection& pose, const Box& box)
+{
+	// keypoint similarity falls off with distance relative to the size of the person, like COCO's object keypoint similarity
+	const float scale = std::max(std::sqrt(std::max(track.m_box.Area(), box.Area())), 1.0f) * 0.1f;
+	float keypointsimilarity = 0;
+	int32_t count = 0;
+	for (size_t i = 0; i < pose.m_keypoints.size(); i++)
+	{
+		if (pose.m_keypoints[i].m_presence == KEYPOINT_PRESENCE_PRESENT && track.m_pose.m_keypoints[i].m_presence == KEYPOINT_PRESENCE_PRESENT)
+		{
+			const float d2 = pose.m_keypoints[i].m_pos.Distance2(track.m_pose.m_keypoints[i].m_pos);
+			keypointsimilarity += std::exp(-d2 / (2.0f * scale * scale));
+			count++;
+		}
+	}
+	if (count > 0)
+	{
+		keypointsimilarity /= static_cast<float>(count);
+	}
+
+	return (track.m_box.IoU(box) + keypointsimilarity) / 2.0f;
+}
+
+float PoseTracker::Box::Area() const
+{
+	return std::max(m_x1 - m_x0, 0.0f) * std::max(m_y1 - m_y0, 0.0f);
+}
+
+float PoseTracker::Box::IoU(const Box& rhs) const
+{
+	Box intersection;
+	intersection.m_x0 = std::max(m_x0, rhs.m_x0);
+	intersection.m_y0 = std::max(m_y0, rhs.m_y0);
+	intersection.m_x1 = std::min(m_x1, rhs.m_x1);
+	intersection.m_y1 = std::min(m_y1, rhs.m_y1);
+	const float overlap = intersection.Area();
+	const float total = Area() + rhs.Area() - overlap;
+	return (total > 0) ? overlap / total : 0.0f;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "posekeypointdata.h"
+
+enum PoseSubject
+{
+	POSE_SUBJECT_LARGEST = 0,
+	POSE_SUBJECT_CENTER,
+	POSE_SUBJECT_PINNED,
+	POSE_SUBJECT_MAX
+};
+
+extern std::array<std::string, PoseSubject::POSE_SUBJECT_MAX> PoseSubjectName;
+
+// name is largest, center or the track id to pin, returns false if it's none of those
+bool GetPoseSubject(const std::string& name, PoseSubject& subject, int32_t& pinnedid);
+
+/*
+
+	Gives the people found in consecutive frames stable ids and picks the one person whose poses are sent on
+	Poses are matched to the tracks from earlier frames by how much their keypoint bounding boxes overlap and how close their keypoints are
+
+	Once a subject is picked it stays the subject for as long as it's tracked, a new one is only picked when it's lost
+	A pinned subject is only ever the person with that id
+
+*/
+
+class PoseTracker
+{
+public:
+	PoseTracker();
+	~PoseTracker();
+
+	void Configure(const PoseSubject subject, const int32_t pinnedid);
+
+	// sets m_id of each pose and returns the index of the subject in poses, or -1 if the subject isn't among them
+	int32_t Update(std::vector<PoseDetection>& poses, const int32_t width, const int32_t height);
+
+private:
+
+	struct Box
+	{
+		float m_x0{ 0.0 };
+		float m_y0{ 0.0 };
+		float m_x1{ 0.0 };
+		float m_y1{ 0.0 };
+
+		float Area() const;
+		float IoU(const Box& rhs) const;
+	};
+
+	struct Track
+	{
+		int32_t m_id{ -1 };
+		int32_t m_missed{ 0 };				// frames in a row the track wasn't matched
+		Box m_box;
+		PoseDetection m_pose;
+	};
+
+	static bool GetBox(const PoseDetection& pose, Box& box);
+	static float Similarity(const Track& track, const PoseDetection& pose, const Box& box);
+
+	static constexpr int32_t MAX_MISSED = 10;
+	static constexpr float MIN_SIMILARITY = 0.3f;
+
+	PoseSubject m_subject;
+	int32_t m_pinnedid;
+	int32_t m_subjectid;
+	int32_t m_nextid;
+	std::vector<Track> m_tracks;
+
+};
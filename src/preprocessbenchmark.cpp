@@ -0,0 +1,312 @@
+#include "preprocessbenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "opencvfunctions.h"
+#include "preprocessfunctions.h"
+
+namespace
+{
+
+	// the per pixel loops PoseDetectorThread used before the kernels, kept as the baseline
+	void LoopFloatInput(const uint8_t* imgdata, float* data, const int64_t pixels, const float div, const float add)
+	{
+		for (int64_t pix = 0; pix < pixels; pix++)
+		{
+			data[(pix * 3) + 0] = (static_cast<float>(imgdata[(pix * 3) + 2]) / div) + add;
+			data[(pix * 3) + 1] = (static_cast<float>(imgdata[(pix * 3) + 1]) / div) + add;
+			data[(pix * 3) + 2] = (static_cast<float>(imgdata[(pix * 3) + 0]) / div) + add;
+		}
+	}
+
+	// the original loop converted out of range values to uint8 unclamped, which is undefined, so this clamps like the lut does
+	void LoopUint8Input(const uint8_t* imgdata, uint8_t* data, const int64_t pixels, const float div, const float add)
+	{
+		auto normalize = [div, add](const uint8_t v) { return static_cast<uint8_t>(std::min(std::max((static_cast<float>(v) / div) + add, 0.0f), 255.0f)); };
+		for (int64_t pix = 0; pix < pixels; pix++)
+		{
+			data[(pix * 3) + 0] = normalize(imgdata[(pix * 3) + 2]);
+			data[(pix * 3) + 1] = normalize(imgdata[(pix * 3) + 1]);
+			data[(pix * 3) + 2] = normalize(imgdata[(pix * 3) + 0]);
+		}
+	}
+
+	// kernels multiply by 1 / div instead of dividing, so float results can be an ulp or two away from the loop
+	bool MatchesFloat(const std::vector<float>& expected, const std::vector<float>& actual)
+	{
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			if (std::abs(expected[i] - actual[i]) > 1e-5f * std::max(1.0f, std::abs(expected[i])))
+			{
+				std::cout << "  mismatch at " << i << ": expected " << expected[i] << " got " << actual[i] << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool MatchesUint8(const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual)
+	{
+		const std::pair<std::vector<uint8_t>::const_iterator, std::vector<uint8_t>::const_iterator> mismatch = std::mismatch(expected.begin(), expected.end(), actual.begin());
+		if (mismatch.first != expected.end())
+		{
+			std::cout << "  mismatch at " << (mismatch.first - expected.begin()) << ": expected " << static_cast<int32_t>(*mismatch.first) << " got " << static_cast<int32_t>(*mismatch.second) << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// returns average microseconds per call
+	double TimeKernel(const std::function<void()>& kernel)
+	{
+		const int32_t warmup = 50;
+		const int32_t iterations = 2000;
+		for (int32_t i = 0; i < warmup; i++)
+		{
+			kernel();
+		}
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int32_t i = 0; i < iterations; i++)
+		{
+			kernel();
+		}
+		const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::micro>(end - start).count() / static_cast<double>(iterations);
+	}
+
+	void PrintResult(const std::string& name, const double us, const double baselineus)
+	{
+		std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2) << std::setw(10) << us << " us" << std::setw(8) << (us > 0.0 ? baselineus / us : 0.0) << "x" << std::defaultfloat << std::endl;
+	}
+
+	/*
+		Center crop and resize of a BGR or YUYV camera frame, against the OpenCV conversion and resize into an intermediate image followed by a kernel pass that it replaced
+		Each SIMD kernel is checked against the scalar passes and its NCHW output against the NHWC one, cv::resize rounds to 8 bits in between so it isn't compared
+	*/
+	bool RunResizeBenchmark(const cv::Mat& frame, const int32_t size, const float div, const float add, const uint8_t* lut)
+	{
+		bool passed = true;
+		const bool yuyv = IsYUYVImage(frame);
+		const std::string description = std::to_string(size) + "x" + std::to_string(size) + " from " + std::to_string(frame.cols) + "x" + std::to_string(frame.rows) + (yuyv ? " YUYV" : " BGR");
+		const int64_t framestride = static_cast<int64_t>(frame.step);
+		const int64_t pixels = static_cast<int64_t>(size) * size;
+
+		int32_t cropx = 0;
+		int32_t cropy = 0;
+		int32_t cropsize = 0;
+		GetCenterCrop(frame.cols, frame.rows, cropx, cropy, cropsize);
+		CropResizePreprocessor preprocessor;
+		preprocessor.SetGeometry(frame.cols, frame.rows, cropx, cropy, cropsize, size, yuyv ? PIXEL_FORMAT_YUYV : PIXEL_FORMAT_BGR);
+
+		std::vector<float> floatexpected(pixels * 3);
+		std::vector<uint8_t> uint8expected(pixels * 3);
+		preprocessor.Process(frame.data, framestride, floatexpected.data(), 1.0f / div, add, PREPROCESS_KERNEL_SCALAR);
+		preprocessor.Process(frame.data, framestride, uint8expected.data(), lut, PREPROCESS_KERNEL_SCALAR);
+		for (int32_t k = PREPROCESS_KERNEL_SSE41; k < PREPROCESS_KERNEL_MAX; k++)
+		{
+			const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+			if (IsPreprocessKernelSupported(kernel))
+			{
+				std::vector<float> floatout(pixels * 3);
+				std::vector<uint8_t> uint8out(pixels * 3);
+				preprocessor.Process(frame.data, framestride, floatout.data(), 1.0f / div, add, kernel);
+				preprocessor.Process(frame.data, framestride, uint8out.data(), lut, kernel);
+				if (!MatchesFloat(floatexpected, floatout))
+				{
+					std::cout << PreprocessKernelName[k] << " float resize differs from the scalar one at " << description << std::endl;
+					passed = false;
+				}
+				if (!MatchesUint8(uint8expected, uint8out))
+				{
+					std::cout << PreprocessKernelName[k] << " uint8 resize differs from the scalar one at " << description << std::endl;
+					passed = false;
+				}
+			}
+		}
+
+		// NCHW has to hold the same values as planes
+		std::vector<float> floatplanar(pixels * 3);
+		std::vector<uint8_t> uint8planar(pixels * 3);
+		for (int64_t i = 0; i < pixels; i++)
+		{
+			for (int64_t c = 0; c < 3; c++)
+			{
+				floatplanar[(c * pixels) + i] = floatexpected[(i * 3) + c];
+				uint8planar[(c * pixels) + i] = uint8expected[(i * 3) + c];
+			}
+		}
+		CropResizePreprocessor planarpreprocessor;
+		planarpreprocessor.SetGeometry(frame.cols, frame.rows, cropx, cropy, cropsize, size, yuyv ? PIXEL_FORMAT_YUYV : PIXEL_FORMAT_BGR, TENSOR_LAYOUT_NCHW);
+		for (int32_t k = PREPROCESS_KERNEL_SCALAR; k < PREPROCESS_KERNEL_MAX; k++)
+		{
+			const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+			if (IsPreprocessKernelSupported(kernel))
+			{
+				std::vector<float> floatout(pixels * 3);
+				std::vector<uint8_t> uint8out(pixels * 3);
+				planarpreprocessor.Process(frame.data, framestride, floatout.data(), 1.0f / div, add, kernel);
+				planarpreprocessor.Process(frame.data, framestride, uint8out.data(), lut, kernel);
+				if (!MatchesFloat(floatplanar, floatout) || !MatchesUint8(uint8planar, uint8out))
+				{
+					std::cout << PreprocessKernelName[k] << " NCHW resize differs from NHWC at " << description << std::endl;
+					passed = false;
+				}
+			}
+		}
+
+		std::vector<float> floatout(pixels * 3);
+		std::vector<uint8_t> uint8out(pixels * 3);
+		cv::Mat converted;
+		cv::Mat resized;
+		int32_t offsetx = 0;
+		int32_t offsety = 0;
+		float scale = 1.0f;
+		auto resize = [&]()
+		{
+			if (yuyv)
+			{
+				ConvertToBGR(frame, converted);
+				ResizeCropImage(converted, resized, size, offsetx, offsety, scale);
+			}
+			else
+			{
+				ResizeCropImage(frame, resized, size, offsetx, offsety, scale);
+			}
+		};
+
+		std::cout << description << " float input" << std::endl;
+		const double floatbaseline = TimeKernel([&]() { resize(); BGRToRGBFloat(resized.data, floatout.data(), pixels, 1.0f / div, add); });
+		PrintResult("OpenCV + kernel", floatbaseline, floatbaseline);
+		for (int32_t k = PREPROCESS_KERNEL_SCALAR; k < PREPROCESS_KERNEL_MAX; k++)
+		{
+			const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+			if (IsPreprocessKernelSupported(kernel))
+			{
+				PrintResult(PreprocessKernelName[k], TimeKernel([&]() { preprocessor.Process(frame.data, framestride, floatout.data(), 1.0f / div, add, kernel); }), floatbaseline);
+			}
+		}
+
+		std::cout << description << " uint8 input" << std::endl;
+		const double uint8baseline = TimeKernel([&]() { resize(); BGRToRGBUint8(resized.data, uint8out.data(), pixels, lut); });
+		PrintResult("OpenCV + kernel", uint8baseline, uint8baseline);
+		for (int32_t k = PREPROCESS_KERNEL_SCALAR; k < PREPROCESS_KERNEL_MAX; k++)
+		{
+			const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+			if (IsPreprocessKernelSupported(kernel))
+			{
+				PrintResult(PreprocessKernelName[k], TimeKernel([&]() { preprocessor.Process(frame.data, framestride, uint8out.data(), lut, kernel); }), uint8baseline);
+			}
+		}
+		return passed;
+	}
+
+}	// namespace
+
+bool RunPreprocessBenchmark(const float div, const float add)
+{
+	bool passed = true;
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int32_t> dist(0, 255);
+
+	std::array<uint8_t, 256> lut;
+	const bool uselut = BuildNormalizeLUT(lut, div, add);
+
+	std::cout << "Preprocessing benchmark (divide " << div << ", add " << add << ")" << std::endl;
+
+	for (const int64_t size : { 192, 256 })
+	{
+		const int64_t pixels = size * size;
+		std::vector<uint8_t> bgr(pixels * 3);
+		for (uint8_t& v : bgr)
+		{
+			v = static_cast<uint8_t>(dist(rng));
+		}
+		// odd sizes leave a tail for the scalar code after the SIMD loop
+		for (const int64_t count : { pixels, pixels - 7 })
+		{
+			std::vector<float> floatexpected(count * 3);
+			std::vector<uint8_t> uint8expected(count * 3);
+			LoopFloatInput(bgr.data(), floatexpected.data(), count, div, add);
+			LoopUint8Input(bgr.data(), uint8expected.data(), count, div, add);
+			for (int32_t k = PREPROCESS_KERNEL_SCALAR; k < PREPROCESS_KERNEL_MAX; k++)
+			{
+				const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+				if (IsPreprocessKernelSupported(kernel))
+				{
+					std::vector<float> floatout(count * 3);
+					std::vector<uint8_t> uint8out(count * 3);
+					BGRToRGBFloat(bgr.data(), floatout.data(), count, 1.0f / div, add, kernel);
+					BGRToRGBUint8(bgr.data(), uint8out.data(), count, uselut ? lut.data() : nullptr, kernel);
+					if (!MatchesFloat(floatexpected, floatout))
+					{
+						std::cout << PreprocessKernelName[k] << " float output differs from the loop for " << count << " pixels" << std::endl;
+						passed = false;
+					}
+					if (!MatchesUint8(uint8expected, uint8out))
+					{
+						std::cout << PreprocessKernelName[k] << " uint8 output differs from the loop for " << count << " pixels" << std::endl;
+						passed = false;
+					}
+				}
+			}
+		}
+
+		std::vector<float> floatout(pixels * 3);
+		std::vector<uint8_t> uint8out(pixels * 3);
+
+		std::cout << size << "x" << size << " float input" << std::endl;
+		const double floatbaseline = TimeKernel([&]() { LoopFloatInput(bgr.data(), floatout.data(), pixels, div, add); });
+		PrintResult("Loop", floatbaseline, floatbaseline);
+		for (int32_t k = PREPROCESS_KERNEL_SCALAR; k < PREPROCESS_KERNEL_MAX; k++)
+		{
+			const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+			if (IsPreprocessKernelSupported(kernel))
+			{
+				PrintResult(PreprocessKernelName[k], TimeKernel([&]() { BGRToRGBFloat(bgr.data(), floatout.data(), pixels, 1.0f / div, add, kernel); }), floatbaseline);
+			}
+		}
+
+		std::cout << size << "x" << size << " uint8 input" << std::endl;
+		const double uint8baseline = TimeKernel([&]() { LoopUint8Input(bgr.data(), uint8out.data(), pixels, div, add); });
+		PrintResult("Loop", uint8baseline, uint8baseline);
+		for (int32_t k = PREPROCESS_KERNEL_SCALAR; k < PREPROCESS_KERNEL_MAX; k++)
+		{
+			const PreprocessKernel kernel = static_cast<PreprocessKernel>(k);
+			if (IsPreprocessKernelSupported(kernel))
+			{
+				PrintResult(PreprocessKernelName[k], TimeKernel([&]() { BGRToRGBUint8(bgr.data(), uint8out.data(), pixels, uselut ? lut.data() : nullptr, kernel); }), uint8baseline);
+			}
+		}
+	}
+
+	// the kernels run on one thread, so OpenCV does too
+	cv::Mat bgrframe(480, 640, CV_8UC3);
+	cv::Mat yuyvframe(480, 640, CV_8UC2);
+	cv::randu(bgrframe, cv::Scalar::all(0), cv::Scalar::all(256));
+	cv::randu(yuyvframe, cv::Scalar::all(0), cv::Scalar::all(256));
+	const int opencvthreads = cv::getNumThreads();
+	cv::setNumThreads(1);
+	for (const cv::Mat* frame : { &bgrframe, &yuyvframe })
+	{
+		for (const int32_t size : { 192, 256 })
+		{
+			passed = RunResizeBenchmark(*frame, size, div, add, uselut ? lut.data() : nullptr) && passed;
+		}
+	}
+	cv::setNumThreads(opencvthreads);
+
+	std::cout << "Selected kernel " << PreprocessKernelName[GetBestPreprocessKernel()] << std::endl;
+	std::cout << (passed ? "All kernels match the loops" : "Some kernels don't match the loops") << std::endl;
+	return passed;
+}
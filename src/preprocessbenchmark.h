@@ -0,0 +1,6 @@
+#pragma once
+
+// times the preprocessing kernels against the original per pixel loops at the MoveNet input sizes and prints the results
+// then the crop and resize from 640x480 BGR and YUYV frames against OpenCV's conversion and resize followed by a kernel
+// every kernel's output is checked against the loop's first, returns false if any of them differ
+bool RunPreprocessBenchmark(const float div, const float add);
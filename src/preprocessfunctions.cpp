@@ -0,0 +1,1380 @@
+#include "preprocessfunctions.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PREPROCESS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need each function to be compiled for the instruction set it uses, MSVC allows intrinsics anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define PREPROCESS_TARGET(x) __attribute__((target(x)))
+#else
+#define PREPROCESS_TARGET(x)
+#endif
+
+std::array<std::string, PreprocessKernel::PREPROCESS_KERNEL_MAX> PreprocessKernelName{ "Auto","Scalar","SSE4.1","AVX2","AVX-512" };
+std::array<std::string, TensorLayout::TENSOR_LAYOUT_MAX> TensorLayoutName{ "NHWC","NCHW" };
+
+namespace
+{
+
+	void BGRToRGBFloatScalar(const uint8_t* bgr, float* rgb, const int64_t pixels, const float scale, const float add)
+	{
+		for (int64_t pix = 0; pix < pixels; pix++)
+		{
+			rgb[(pix * 3) + 0] = (static_cast<float>(bgr[(pix * 3) + 2]) * scale) + add;
+			rgb[(pix * 3) + 1] = (static_cast<float>(bgr[(pix * 3) + 1]) * scale) + add;
+			rgb[(pix * 3) + 2] = (static_cast<float>(bgr[(pix * 3) + 0]) * scale) + add;
+		}
+	}
+
+	void BGRToRGBUint8Scalar(const uint8_t* bgr, uint8_t* rgb, const int64_t pixels, const uint8_t* lut)
+	{
+		if (lut)
+		{
+			for (int64_t pix = 0; pix < pixels; pix++)
+			{
+				rgb[(pix * 3) + 0] = lut[bgr[(pix * 3) + 2]];
+				rgb[(pix * 3) + 1] = lut[bgr[(pix * 3) + 1]];
+				rgb[(pix * 3) + 2] = lut[bgr[(pix * 3) + 0]];
+			}
+		}
+		else
+		{
+			for (int64_t pix = 0; pix < pixels; pix++)
+			{
+				rgb[(pix * 3) + 0] = bgr[(pix * 3) + 2];
+				rgb[(pix * 3) + 1] = bgr[(pix * 3) + 1];
+				rgb[(pix * 3) + 2] = bgr[(pix * 3) + 0];
+			}
+		}
+	}
+
+	// BT.601 limited range, clamped to 0 - 255
+	inline void YUVToRGB(const float y, const float u, const float v, float& r, float& g, float& b)
+	{
+		const float yy = 1.164f * (y - 16.0f);
+		const float uu = u - 128.0f;
+		const float vv = v - 128.0f;
+		r = std::clamp(yy + (1.596f * vv), 0.0f, 255.0f);
+		g = std::clamp(yy - (0.813f * vv) - (0.391f * uu), 0.0f, 255.0f);
+		b = std::clamp(yy + (2.018f * uu), 0.0f, 255.0f);
+	}
+
+	void YUYVToRGBFloatScalar(const uint8_t* yuyv, float* rgb, const int64_t pixels, const float scale, const float add)
+	{
+		for (int64_t pix = 0; pix < pixels; pix++)
+		{
+			const uint8_t* pair = yuyv + ((pix & ~1LL) * 2);
+			float r, g, b;
+			YUVToRGB(static_cast<float>(yuyv[pix * 2]), static_cast<float>(pair[1]), static_cast<float>(pair[3]), r, g, b);
+			rgb[(pix * 3) + 0] = (r * scale) + add;
+			rgb[(pix * 3) + 1] = (g * scale) + add;
+			rgb[(pix * 3) + 2] = (b * scale) + add;
+		}
+	}
+
+	// adds weight times pixel x of a YUYV row to y, u and v
+	inline void AccumulateYUYV(const uint8_t* row, const int32_t x, const float weight, float& y, float& u, float& v)
+	{
+		const uint8_t* pair = row + ((x & ~1) * 2);
+		y += static_cast<float>(row[x * 2]) * weight;
+		u += static_cast<float>(pair[1]) * weight;
+		v += static_cast<float>(pair[3]) * weight;
+	}
+
+	// horizontal pass of the separable resize, one BGR source row into R, G and B planes
+	void FilterRowBGRScalar(const uint8_t* row, const int32_t* index0, const int32_t* index1, const float* weight0, const float* weight1, const int32_t count, float* r, float* g, float* b)
+	{
+		for (int32_t i = 0; i < count; i++)
+		{
+			const uint8_t* p0 = row + index0[i];
+			const uint8_t* p1 = row + index1[i];
+			b[i] = (static_cast<float>(p0[0]) * weight0[i]) + (static_cast<float>(p1[0]) * weight1[i]);
+			g[i] = (static_cast<float>(p0[1]) * weight0[i]) + (static_cast<float>(p1[1]) * weight1[i]);
+			r[i] = (static_cast<float>(p0[2]) * weight0[i]) + (static_cast<float>(p1[2]) * weight1[i]);
+		}
+	}
+
+	/*
+		Vertical pass, blends the planes of two filtered rows, out = (row0 * weight0) + (row1 * weight1) + add
+		out is interleaved RGB when outplanesize is 0, otherwise R, G and B planes outplanesize values apart
+	*/
+	void BlendRowsFloatScalar(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, const float add, float* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const int64_t channelstride = (outplanesize == 0) ? 1 : outplanesize;
+		for (int32_t i = 0; i < count; i++)
+		{
+			for (int32_t c = 0; c < 3; c++)
+			{
+				out[(i * pixelstride) + (c * channelstride)] = (row0[(c * planesize) + i] * weight0) + (row1[(c * planesize) + i] * weight1) + add;
+			}
+		}
+	}
+
+	void BlendRowsUint8Scalar(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, uint8_t* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const int64_t channelstride = (outplanesize == 0) ? 1 : outplanesize;
+		for (int32_t i = 0; i < count; i++)
+		{
+			for (int32_t c = 0; c < 3; c++)
+			{
+				const float v = (row0[(c * planesize) + i] * weight0) + (row1[(c * planesize) + i] * weight1);
+				out[(i * pixelstride) + (c * channelstride)] = static_cast<uint8_t>(std::min(v + 0.5f, 255.0f));
+			}
+		}
+	}
+
+	// horizontal pass for YUYV into Y, U and V planes, the part of a tap outside the image is black, Y 16 U 128 V 128
+	void FilterRowYUYVScalar(const uint8_t* row, const int32_t* index0, const int32_t* index1, const float* weight0, const float* weight1, const int32_t count, float* y, float* u, float* v)
+	{
+		for (int32_t i = 0; i < count; i++)
+		{
+			const float outside = 1.0f - (weight0[i] + weight1[i]);
+			y[i] = 16.0f * outside;
+			u[i] = 128.0f * outside;
+			v[i] = 128.0f * outside;
+			AccumulateYUYV(row, index0[i], weight0[i], y[i], u[i], v[i]);
+			AccumulateYUYV(row, index1[i], weight1[i], y[i], u[i], v[i]);
+		}
+	}
+
+	// vertical pass for YUYV, blends the Y, U and V planes of two filtered rows then converts to RGB in the same layouts as BlendRowsFloatScalar, out = (rgb * scale) + add
+	void BlendRowsYUYVFloatScalar(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, const float scale, const float add, float* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const int64_t channelstride = (outplanesize == 0) ? 1 : outplanesize;
+		const float outside = 1.0f - (weight0 + weight1);
+		for (int32_t i = 0; i < count; i++)
+		{
+			const float y = (16.0f * outside) + (row0[i] * weight0) + (row1[i] * weight1);
+			const float u = (128.0f * outside) + (row0[planesize + i] * weight0) + (row1[planesize + i] * weight1);
+			const float v = (128.0f * outside) + (row0[(planesize * 2) + i] * weight0) + (row1[(planesize * 2) + i] * weight1);
+			float r, g, b;
+			YUVToRGB(y, u, v, r, g, b);
+			out[i * pixelstride] = (r * scale) + add;
+			out[(i * pixelstride) + channelstride] = (g * scale) + add;
+			out[(i * pixelstride) + (channelstride * 2)] = (b * scale) + add;
+		}
+	}
+
+	void BlendRowsYUYVUint8Scalar(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, uint8_t* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const int64_t channelstride = (outplanesize == 0) ? 1 : outplanesize;
+		const float outside = 1.0f - (weight0 + weight1);
+		for (int32_t i = 0; i < count; i++)
+		{
+			const float y = (16.0f * outside) + (row0[i] * weight0) + (row1[i] * weight1);
+			const float u = (128.0f * outside) + (row0[planesize + i] * weight0) + (row1[planesize + i] * weight1);
+			const float v = (128.0f * outside) + (row0[(planesize * 2) + i] * weight0) + (row1[(planesize * 2) + i] * weight1);
+			float rgb[3];
+			YUVToRGB(y, u, v, rgb[0], rgb[1], rgb[2]);
+			for (int32_t c = 0; c < 3; c++)
+			{
+				out[(i * pixelstride) + (c * channelstride)] = static_cast<uint8_t>(rgb[c] + 0.5f);
+			}
+		}
+	}
+
+	void ApplyLUTScalar(uint8_t* data, const int64_t count, const uint8_t* lut)
+	{
+		for (int64_t i = 0; i < count; i++)
+		{
+			data[i] = lut[data[i]];
+		}
+	}
+
+	// IEEE half precision with round to nearest even, same as the F16C instructions
+	uint16_t FloatToHalfValue(const float value)
+	{
+		uint32_t bits = 0;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		const uint32_t abs = bits & 0x7fffffff;
+
+		if (abs >= 0x7f800000)
+		{
+			return sign | 0x7c00 | ((abs > 0x7f800000) ? 0x0200 : 0);		// inf, or a quiet nan
+		}
+		if (abs >= 0x477ff000)
+		{
+			return sign | 0x7c00;		// rounds past the largest half
+		}
+		if (abs < 0x33000000)
+		{
+			return sign;				// rounds to 0
+		}
+
+		uint32_t half = 0;
+		uint32_t remainder = 0;
+		uint32_t halfway = 0;
+		if (abs < 0x38800000)
+		{
+			// subnormal half, the implicit bit becomes part of the mantissa
+			const uint32_t shift = 126 - (abs >> 23);
+			const uint32_t mantissa = (abs & 0x007fffff) | 0x00800000;
+			half = mantissa >> shift;
+			remainder = mantissa & ((1u << shift) - 1);
+			halfway = 1u << (shift - 1);
+		}
+		else
+		{
+			// rebias the exponent from 127 to 15 and drop 13 mantissa bits
+			half = (abs - 0x38000000) >> 13;
+			remainder = abs & 0x1fff;
+			halfway = 0x1000;
+		}
+		if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+		{
+			half++;		// may carry into the exponent, which is still the right result
+		}
+		return sign | static_cast<uint16_t>(half);
+	}
+
+	void FloatToHalfScalar(const float* in, uint16_t* out, const int64_t count)
+	{
+		for (int64_t i = 0; i < count; i++)
+		{
+			out[i] = FloatToHalfValue(in[i]);
+		}
+	}
+
+	float HalfToFloatValue(const uint16_t value)
+	{
+		const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+		const uint32_t exponent = (value >> 10) & 0x1f;
+		uint32_t mantissa = value & 0x03ff;
+
+		uint32_t bits = 0;
+		if (exponent == 0x1f)
+		{
+			bits = sign | 0x7f800000 | (mantissa << 13) | ((mantissa != 0) ? 0x00400000 : 0);		// inf, or a quiet nan
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		else if (mantissa != 0)
+		{
+			// subnormal half, normalize the mantissa
+			uint32_t e = 113;
+			while ((mantissa & 0x0400) == 0)
+			{
+				mantissa <<= 1;
+				e--;
+			}
+			bits = sign | (e << 23) | ((mantissa & 0x03ff) << 13);
+		}
+		else
+		{
+			bits = sign;
+		}
+
+		float result = 0;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	void HalfToFloatScalar(const uint16_t* in, float* out, const int64_t count)
+	{
+		for (int64_t i = 0; i < count; i++)
+		{
+			out[i] = HalfToFloatValue(in[i]);
+		}
+	}
+
+#ifdef PREPROCESS_X86
+
+	/*
+		Swaps B and R for 16 pixels (48 bytes), reading 52 bytes from bgr
+		Each 16 byte load holds 4 whole pixels (12 bytes) which are shuffled and merged into 3 output registers
+	*/
+	PREPROCESS_TARGET("ssse3")
+	inline void ShuffleBGR16(const uint8_t* bgr, __m128i& out0, __m128i& out1, __m128i& out2)
+	{
+		const __m128i g0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr));
+		const __m128i g1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + 12));
+		const __m128i g2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + 24));
+		const __m128i g3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + 36));
+
+		const __m128i m0 = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, -128, -128, -128, -128);
+		const __m128i m1a = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 1, 0, 5);
+		const __m128i m1b = _mm_setr_epi8(4, 3, 8, 7, 6, 11, 10, 9, -128, -128, -128, -128, -128, -128, -128, -128);
+		const __m128i m2a = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, 2, 1, 0, 5, 4, 3, 8, 7);
+		const __m128i m2b = _mm_setr_epi8(6, 11, 10, 9, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128);
+		const __m128i m3 = _mm_setr_epi8(-128, -128, -128, -128, 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9);
+
+		out0 = _mm_or_si128(_mm_shuffle_epi8(g0, m0), _mm_shuffle_epi8(g1, m1a));
+		out1 = _mm_or_si128(_mm_shuffle_epi8(g1, m1b), _mm_shuffle_epi8(g2, m2a));
+		out2 = _mm_or_si128(_mm_shuffle_epi8(g2, m2b), _mm_shuffle_epi8(g3, m3));
+	}
+
+	PREPROCESS_TARGET("sse4.1")
+	inline void StoreNormalized16SSE41(__m128i v, float* out, const __m128 scale, const __m128 add)
+	{
+		for (int32_t i = 0; i < 4; i++)
+		{
+			const __m128i v32 = _mm_cvtepu8_epi32(v);
+			_mm_storeu_ps(out + (i * 4), _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v32), scale), add));
+			v = _mm_srli_si128(v, 4);
+		}
+	}
+
+	PREPROCESS_TARGET("sse4.1")
+	void BGRToRGBFloatSSE41(const uint8_t* bgr, float* rgb, const int64_t pixels, const float scale, const float add)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		const __m128 vadd = _mm_set1_ps(add);
+		int64_t pix = 0;
+		for (; pix + 18 <= pixels; pix += 16)
+		{
+			__m128i c0, c1, c2;
+			ShuffleBGR16(bgr + (pix * 3), c0, c1, c2);
+			StoreNormalized16SSE41(c0, rgb + (pix * 3), vscale, vadd);
+			StoreNormalized16SSE41(c1, rgb + (pix * 3) + 16, vscale, vadd);
+			StoreNormalized16SSE41(c2, rgb + (pix * 3) + 32, vscale, vadd);
+		}
+		BGRToRGBFloatScalar(bgr + (pix * 3), rgb + (pix * 3), pixels - pix, scale, add);
+	}
+
+	PREPROCESS_TARGET("avx2")
+	inline void StoreNormalized16AVX2(const __m128i v, float* out, const __m256 scale, const __m256 add)
+	{
+		const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+		const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+		_mm256_storeu_ps(out, _mm256_add_ps(_mm256_mul_ps(lo, scale), add));
+		_mm256_storeu_ps(out + 8, _mm256_add_ps(_mm256_mul_ps(hi, scale), add));
+	}
+
+	PREPROCESS_TARGET("avx2")
+	void BGRToRGBFloatAVX2(const uint8_t* bgr, float* rgb, const int64_t pixels, const float scale, const float add)
+	{
+		const __m256 vscale = _mm256_set1_ps(scale);
+		const __m256 vadd = _mm256_set1_ps(add);
+		int64_t pix = 0;
+		for (; pix + 18 <= pixels; pix += 16)
+		{
+			__m128i c0, c1, c2;
+			ShuffleBGR16(bgr + (pix * 3), c0, c1, c2);
+			StoreNormalized16AVX2(c0, rgb + (pix * 3), vscale, vadd);
+			StoreNormalized16AVX2(c1, rgb + (pix * 3) + 16, vscale, vadd);
+			StoreNormalized16AVX2(c2, rgb + (pix * 3) + 32, vscale, vadd);
+		}
+		BGRToRGBFloatScalar(bgr + (pix * 3), rgb + (pix * 3), pixels - pix, scale, add);
+	}
+
+	PREPROCESS_TARGET("avx512f")
+	void BGRToRGBFloatAVX512(const uint8_t* bgr, float* rgb, const int64_t pixels, const float scale, const float add)
+	{
+		const __m512 vscale = _mm512_set1_ps(scale);
+		const __m512 vadd = _mm512_set1_ps(add);
+		int64_t pix = 0;
+		for (; pix + 18 <= pixels; pix += 16)
+		{
+			__m128i c0, c1, c2;
+			ShuffleBGR16(bgr + (pix * 3), c0, c1, c2);
+			_mm512_storeu_ps(rgb + (pix * 3), _mm512_add_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(c0)), vscale), vadd));
+			_mm512_storeu_ps(rgb + (pix * 3) + 16, _mm512_add_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(c1)), vscale), vadd));
+			_mm512_storeu_ps(rgb + (pix * 3) + 32, _mm512_add_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(c2)), vscale), vadd));
+		}
+		BGRToRGBFloatScalar(bgr + (pix * 3), rgb + (pix * 3), pixels - pix, scale, add);
+	}
+
+	PREPROCESS_TARGET("ssse3")
+	void BGRToRGBUint8SSSE3(const uint8_t* bgr, uint8_t* rgb, const int64_t pixels)
+	{
+		int64_t pix = 0;
+		for (; pix + 18 <= pixels; pix += 16)
+		{
+			__m128i c0, c1, c2;
+			ShuffleBGR16(bgr + (pix * 3), c0, c1, c2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb + (pix * 3)), c0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb + (pix * 3) + 16), c1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb + (pix * 3) + 32), c2);
+		}
+		BGRToRGBUint8Scalar(bgr + (pix * 3), rgb + (pix * 3), pixels - pix, nullptr);
+	}
+
+	/*
+		256 entry byte lookup on 64 bytes at a time
+		Each permute looks up 128 entries with the low 7 bits of the index, the top bit picks which half the result comes from
+		SSSE3 and AVX2 can only do this with 16 shuffles of 16 entries each, which is slower than scalar lookups, so those stay scalar
+	*/
+	PREPROCESS_TARGET("avx512f,avx512bw,avx512vbmi")
+	void ApplyLUTAVX512VBMI(uint8_t* data, const int64_t count, const uint8_t* lut)
+	{
+		const __m512i lut0 = _mm512_loadu_si512(lut);
+		const __m512i lut1 = _mm512_loadu_si512(lut + 64);
+		const __m512i lut2 = _mm512_loadu_si512(lut + 128);
+		const __m512i lut3 = _mm512_loadu_si512(lut + 192);
+		int64_t i = 0;
+		for (; i + 64 <= count; i += 64)
+		{
+			const __m512i v = _mm512_loadu_si512(data + i);
+			const __m512i low = _mm512_permutex2var_epi8(lut0, v, lut1);
+			const __m512i high = _mm512_permutex2var_epi8(lut2, v, lut3);
+			_mm512_storeu_si512(data + i, _mm512_mask_blend_epi8(_mm512_movepi8_mask(v), low, high));
+		}
+		for (; i < count; i++)
+		{
+			data[i] = lut[data[i]];
+		}
+	}
+
+	// same as YUVToRGB for 8 pixels
+	PREPROCESS_TARGET("avx2")
+	inline void YUVToRGBAVX2(const __m256 y, const __m256 u, const __m256 v, __m256& r, __m256& g, __m256& b)
+	{
+		const __m256 vzero = _mm256_setzero_ps();
+		const __m256 v255 = _mm256_set1_ps(255.0f);
+		const __m256 yy = _mm256_mul_ps(_mm256_sub_ps(y, _mm256_set1_ps(16.0f)), _mm256_set1_ps(1.164f));
+		const __m256 uu = _mm256_sub_ps(u, _mm256_set1_ps(128.0f));
+		const __m256 vv = _mm256_sub_ps(v, _mm256_set1_ps(128.0f));
+		r = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(yy, _mm256_mul_ps(vv, _mm256_set1_ps(1.596f))), vzero), v255);
+		g = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(yy, _mm256_mul_ps(vv, _mm256_set1_ps(0.813f))), _mm256_mul_ps(uu, _mm256_set1_ps(0.391f))), vzero), v255);
+		b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(yy, _mm256_mul_ps(uu, _mm256_set1_ps(2.018f))), vzero), v255);
+	}
+
+	/*
+		Converts 8 pixels (16 bytes) per iteration
+		Y, U and V are spread to one byte per pixel with a shuffle, the pair's U and V going to both of its pixels, then converted in float
+	*/
+	PREPROCESS_TARGET("avx2")
+	void YUYVToRGBFloatAVX2(const uint8_t* yuyv, float* rgb, const int64_t pixels, const float scale, const float add)
+	{
+		const __m128i ymask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -128, -128, -128, -128, -128, -128, -128, -128);
+		const __m128i umask = _mm_setr_epi8(1, 1, 5, 5, 9, 9, 13, 13, -128, -128, -128, -128, -128, -128, -128, -128);
+		const __m128i vmask = _mm_setr_epi8(3, 3, 7, 7, 11, 11, 15, 15, -128, -128, -128, -128, -128, -128, -128, -128);
+		const __m256 vscale = _mm256_set1_ps(scale);
+		const __m256 vadd = _mm256_set1_ps(add);
+
+		alignas(32) float planes[3][8];
+		int64_t pix = 0;
+		for (; pix + 8 <= pixels; pix += 8)
+		{
+			const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuyv + (pix * 2)));
+			__m256 r, g, b;
+			YUVToRGBAVX2(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(in, ymask))), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(in, umask))), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(in, vmask))), r, g, b);
+
+			_mm256_store_ps(planes[0], _mm256_add_ps(_mm256_mul_ps(r, vscale), vadd));
+			_mm256_store_ps(planes[1], _mm256_add_ps(_mm256_mul_ps(g, vscale), vadd));
+			_mm256_store_ps(planes[2], _mm256_add_ps(_mm256_mul_ps(b, vscale), vadd));
+
+			float* out = rgb + (pix * 3);
+			for (int32_t i = 0; i < 8; i++)
+			{
+				out[(i * 3) + 0] = planes[0][i];
+				out[(i * 3) + 1] = planes[1][i];
+				out[(i * 3) + 2] = planes[2][i];
+			}
+		}
+		YUYVToRGBFloatScalar(yuyv + (pix * 2), rgb + (pix * 3), pixels - pix, scale, add);
+	}
+
+	// 8 pixels from R, G and B registers to 24 interleaved values
+	PREPROCESS_TARGET("avx2")
+	inline void Interleave8AVX2(const __m256 r, const __m256 g, const __m256 b, __m256& out0, __m256& out1, __m256& out2)
+	{
+		// r0 r3 r6 r1 r4 r7 r2 r5, g5 g0 g3 g6 g1 g4 g7 g2, b2 b5 b0 b3 b6 b1 b4 b7 - every output position then has its value in one of the three
+		const __m256 rp = _mm256_permutevar8x32_ps(r, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+		const __m256 gp = _mm256_permutevar8x32_ps(g, _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2));
+		const __m256 bp = _mm256_permutevar8x32_ps(b, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+		out0 = _mm256_blend_ps(_mm256_blend_ps(rp, gp, 0x92), bp, 0x24);
+		out1 = _mm256_blend_ps(_mm256_blend_ps(rp, gp, 0x24), bp, 0x49);
+		out2 = _mm256_blend_ps(_mm256_blend_ps(rp, gp, 0x49), bp, 0x92);
+	}
+
+	PREPROCESS_TARGET("avx2")
+	inline void StoreInterleaved8AVX2(float* out, const __m256 r, const __m256 g, const __m256 b)
+	{
+		__m256 out0, out1, out2;
+		Interleave8AVX2(r, g, b, out0, out1, out2);
+		_mm256_storeu_ps(out, out0);
+		_mm256_storeu_ps(out + 8, out1);
+		_mm256_storeu_ps(out + 16, out2);
+	}
+
+	// 8 pixels to interleaved RGB when outplanesize is 0, otherwise 8 values to each of the 3 planes
+	PREPROCESS_TARGET("avx2")
+	inline void StoreRGB8AVX2(float* out, const int64_t outplanesize, const __m256 r, const __m256 g, const __m256 b)
+	{
+		if (outplanesize == 0)
+		{
+			StoreInterleaved8AVX2(out, r, g, b);
+			return;
+		}
+		_mm256_storeu_ps(out, r);
+		_mm256_storeu_ps(out + outplanesize, g);
+		_mm256_storeu_ps(out + (outplanesize * 2), b);
+	}
+
+	// rounds and saturates to bytes like the scalar code, writes exactly 24 bytes
+	PREPROCESS_TARGET("avx2")
+	inline void StoreInterleaved8Uint8AVX2(uint8_t* out, const __m256 r, const __m256 g, const __m256 b)
+	{
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 v255 = _mm256_set1_ps(255.0f);
+		__m256 out0, out1, out2;
+		Interleave8AVX2(_mm256_min_ps(_mm256_add_ps(r, half), v255), _mm256_min_ps(_mm256_add_ps(g, half), v255), _mm256_min_ps(_mm256_add_ps(b, half), v255), out0, out1, out2);
+
+		// the packs work within 128 bit lanes, the permutes put the 8 values of each register back in order
+		const __m256i words01 = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_cvttps_epi32(out0), _mm256_cvttps_epi32(out1)), 0xd8);
+		const __m256i words2 = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_cvttps_epi32(out2), _mm256_cvttps_epi32(out2)), 0xd8);
+		const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words01, words2), _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(bytes));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm256_extracti128_si256(bytes, 1));
+	}
+
+	PREPROCESS_TARGET("avx2")
+	inline void StoreRGB8Uint8AVX2(uint8_t* out, const int64_t outplanesize, const __m256 r, const __m256 g, const __m256 b)
+	{
+		if (outplanesize == 0)
+		{
+			StoreInterleaved8Uint8AVX2(out, r, g, b);
+			return;
+		}
+
+		// r0-3 g0-3 b0-3 b0-3 | r4-7 g4-7 b4-7 b4-7 after the packs, the permute puts each plane's 8 bytes together
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 v255 = _mm256_set1_ps(255.0f);
+		const __m256i rg = _mm256_packus_epi32(_mm256_cvttps_epi32(_mm256_min_ps(_mm256_add_ps(r, half), v255)), _mm256_cvttps_epi32(_mm256_min_ps(_mm256_add_ps(g, half), v255)));
+		const __m256i bw = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_add_ps(b, half), v255));
+		const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(rg, _mm256_packus_epi32(bw, bw)), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(bytes));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + outplanesize), _mm_srli_si128(_mm256_castsi256_si128(bytes), 8));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + (outplanesize * 2)), _mm256_extracti128_si256(bytes, 1));
+	}
+
+	/*
+		Gathers the two taps of 8 output pixels as 4 byte loads, B G R and the next pixel's B, so the last source pixel of the row is left to the scalar code
+		gathercount is how many of the leading taps are safe to load that way
+	*/
+	PREPROCESS_TARGET("avx2")
+	void FilterRowBGRAVX2(const uint8_t* row, const int32_t* index0, const int32_t* index1, const float* weight0, const float* weight1, const int32_t count, const int32_t gathercount, float* r, float* g, float* b)
+	{
+		const __m256i mask = _mm256_set1_epi32(0xff);
+		const int* base = reinterpret_cast<const int*>(row);
+		int32_t i = 0;
+		for (; i + 8 <= gathercount; i += 8)
+		{
+			const __m256i p0 = _mm256_i32gather_epi32(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index0 + i)), 1);
+			const __m256i p1 = _mm256_i32gather_epi32(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index1 + i)), 1);
+			const __m256 w0 = _mm256_loadu_ps(weight0 + i);
+			const __m256 w1 = _mm256_loadu_ps(weight1 + i);
+
+			const __m256 b0 = _mm256_cvtepi32_ps(_mm256_and_si256(p0, mask));
+			const __m256 b1 = _mm256_cvtepi32_ps(_mm256_and_si256(p1, mask));
+			const __m256 g0 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask));
+			const __m256 g1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p1, 8), mask));
+			const __m256 r0 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p0, 16), mask));
+			const __m256 r1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p1, 16), mask));
+
+			_mm256_storeu_ps(b + i, _mm256_add_ps(_mm256_mul_ps(b0, w0), _mm256_mul_ps(b1, w1)));
+			_mm256_storeu_ps(g + i, _mm256_add_ps(_mm256_mul_ps(g0, w0), _mm256_mul_ps(g1, w1)));
+			_mm256_storeu_ps(r + i, _mm256_add_ps(_mm256_mul_ps(r0, w0), _mm256_mul_ps(r1, w1)));
+		}
+		FilterRowBGRScalar(row, index0 + i, index1 + i, weight0 + i, weight1 + i, count - i, r + i, g + i, b + i);
+	}
+
+	/*
+		Gathers the pixel pair of each tap as 4 bytes, Y0 U Y1 V, and shifts the tap's Y down for odd pixels
+		A pair is always inside the row, so every tap can be gathered
+	*/
+	PREPROCESS_TARGET("avx2")
+	inline void GatherYUYV8AVX2(const uint8_t* row, const __m256i index, __m256& y, __m256& u, __m256& v)
+	{
+		const __m256i mask = _mm256_set1_epi32(0xff);
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i pair = _mm256_i32gather_epi32(reinterpret_cast<const int*>(row), _mm256_slli_epi32(_mm256_andnot_si256(one, index), 1), 1);
+		y = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srlv_epi32(pair, _mm256_slli_epi32(_mm256_and_si256(index, one), 4)), mask));
+		u = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pair, 8), mask));
+		v = _mm256_cvtepi32_ps(_mm256_srli_epi32(pair, 24));
+	}
+
+	PREPROCESS_TARGET("avx2")
+	void FilterRowYUYVAVX2(const uint8_t* row, const int32_t* index0, const int32_t* index1, const float* weight0, const float* weight1, const int32_t count, float* y, float* u, float* v)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 v16 = _mm256_set1_ps(16.0f);
+		const __m256 v128 = _mm256_set1_ps(128.0f);
+		int32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 y0, u0, v0, y1, u1, v1;
+			GatherYUYV8AVX2(row, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index0 + i)), y0, u0, v0);
+			GatherYUYV8AVX2(row, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index1 + i)), y1, u1, v1);
+			const __m256 w0 = _mm256_loadu_ps(weight0 + i);
+			const __m256 w1 = _mm256_loadu_ps(weight1 + i);
+			const __m256 outside = _mm256_sub_ps(one, _mm256_add_ps(w0, w1));
+
+			_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v16, outside), _mm256_mul_ps(y0, w0)), _mm256_mul_ps(y1, w1)));
+			_mm256_storeu_ps(u + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v128, outside), _mm256_mul_ps(u0, w0)), _mm256_mul_ps(u1, w1)));
+			_mm256_storeu_ps(v + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v128, outside), _mm256_mul_ps(v0, w0)), _mm256_mul_ps(v1, w1)));
+		}
+		FilterRowYUYVScalar(row, index0 + i, index1 + i, weight0 + i, weight1 + i, count - i, y + i, u + i, v + i);
+	}
+
+	PREPROCESS_TARGET("avx2")
+	inline void BlendYUV8AVX2(const float* row0, const float* row1, const int64_t planesize, const __m256 w0, const __m256 w1, const __m256 yfill, const __m256 uvfill, __m256& r, __m256& g, __m256& b)
+	{
+		const __m256 y = _mm256_add_ps(_mm256_add_ps(yfill, _mm256_mul_ps(_mm256_loadu_ps(row0), w0)), _mm256_mul_ps(_mm256_loadu_ps(row1), w1));
+		const __m256 u = _mm256_add_ps(_mm256_add_ps(uvfill, _mm256_mul_ps(_mm256_loadu_ps(row0 + planesize), w0)), _mm256_mul_ps(_mm256_loadu_ps(row1 + planesize), w1));
+		const __m256 v = _mm256_add_ps(_mm256_add_ps(uvfill, _mm256_mul_ps(_mm256_loadu_ps(row0 + (planesize * 2)), w0)), _mm256_mul_ps(_mm256_loadu_ps(row1 + (planesize * 2)), w1));
+		YUVToRGBAVX2(y, u, v, r, g, b);
+	}
+
+	PREPROCESS_TARGET("avx2")
+	void BlendRowsYUYVFloatAVX2(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, const float scale, const float add, float* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const float outside = 1.0f - (weight0 + weight1);
+		const __m256 w0 = _mm256_set1_ps(weight0);
+		const __m256 w1 = _mm256_set1_ps(weight1);
+		const __m256 yfill = _mm256_set1_ps(16.0f * outside);
+		const __m256 uvfill = _mm256_set1_ps(128.0f * outside);
+		const __m256 vscale = _mm256_set1_ps(scale);
+		const __m256 vadd = _mm256_set1_ps(add);
+		int32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 r, g, b;
+			BlendYUV8AVX2(row0 + i, row1 + i, planesize, w0, w1, yfill, uvfill, r, g, b);
+			StoreRGB8AVX2(out + (i * pixelstride), outplanesize, _mm256_add_ps(_mm256_mul_ps(r, vscale), vadd), _mm256_add_ps(_mm256_mul_ps(g, vscale), vadd), _mm256_add_ps(_mm256_mul_ps(b, vscale), vadd));
+		}
+		BlendRowsYUYVFloatScalar(row0 + i, row1 + i, planesize, count - i, weight0, weight1, scale, add, out + (i * pixelstride), outplanesize);
+	}
+
+	PREPROCESS_TARGET("avx2")
+	void BlendRowsYUYVUint8AVX2(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, uint8_t* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const float outside = 1.0f - (weight0 + weight1);
+		const __m256 w0 = _mm256_set1_ps(weight0);
+		const __m256 w1 = _mm256_set1_ps(weight1);
+		const __m256 yfill = _mm256_set1_ps(16.0f * outside);
+		const __m256 uvfill = _mm256_set1_ps(128.0f * outside);
+		int32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 r, g, b;
+			BlendYUV8AVX2(row0 + i, row1 + i, planesize, w0, w1, yfill, uvfill, r, g, b);
+			StoreRGB8Uint8AVX2(out + (i * pixelstride), outplanesize, r, g, b);
+		}
+		BlendRowsYUYVUint8Scalar(row0 + i, row1 + i, planesize, count - i, weight0, weight1, out + (i * pixelstride), outplanesize);
+	}
+
+	PREPROCESS_TARGET("avx512f,avx512bw")
+	inline __m512 BytesToFloat16(const __m128i v)
+	{
+		return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v));
+	}
+
+	// (a0 * w0) + (a1 * w1) rounded after each operation like the scalar code, the compiler would otherwise fuse the plain AVX-512 ops into an FMA
+	PREPROCESS_TARGET("avx512f")
+	inline __m512 Blend16(const __m512 a0, const __m512 w0, const __m512 a1, const __m512 w1)
+	{
+		const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+		return _mm512_add_round_ps(_mm512_mul_round_ps(a0, w0, rounding), _mm512_mul_round_ps(a1, w1, rounding), rounding);
+	}
+
+	// (fill * outside) + (a0 * w0) + (a1 * w1) in the same order as FilterRowYUYVScalar
+	PREPROCESS_TARGET("avx512f")
+	inline __m512 FillBlend16(const __m512 fill, const __m512 outside, const __m512 a0, const __m512 w0, const __m512 a1, const __m512 w1)
+	{
+		const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+		return _mm512_add_round_ps(_mm512_add_round_ps(_mm512_mul_round_ps(fill, outside, rounding), _mm512_mul_round_ps(a0, w0, rounding), rounding), _mm512_mul_round_ps(a1, w1, rounding), rounding);
+	}
+
+	/*
+		Horizontal pass for 16 output pixels at a time without gathers, for the leading blocks whose taps are all within 256 bytes of the row
+		Each block loads its window and picks the 96 tap bytes with byte permutes as in ApplyLUTAVX512VBMI, the 3 planes of the first taps then the 3 of the second
+		windowindex holds 128 bytes of permute indices per block, for YUYV the black fill outside the image is added like FilterRowYUYVScalar does
+	*/
+	PREPROCESS_TARGET("avx512f,avx512bw,avx512vbmi")
+	void FilterRowWindowAVX512VBMI(const uint8_t* row, const int32_t* windowstart, const uint8_t* windowindex, const int32_t windowcount, const float* weight0, const float* weight1, const bool yuyv, float* plane0, float* plane1, float* plane2)
+	{
+		const __m512 one = _mm512_set1_ps(1.0f);
+		const __m512 v16 = _mm512_set1_ps(16.0f);
+		const __m512 v128 = _mm512_set1_ps(128.0f);
+		for (int32_t block = 0; block < windowcount; block++)
+		{
+			const int32_t i = block * 16;
+			const uint8_t* window = row + windowstart[block];
+			const __m512i s0 = _mm512_loadu_si512(window);
+			const __m512i s1 = _mm512_loadu_si512(window + 64);
+			const __m512i s2 = _mm512_loadu_si512(window + 128);
+			const __m512i s3 = _mm512_loadu_si512(window + 192);
+			const __m512i idx0 = _mm512_loadu_si512(windowindex + (block * 128));
+			const __m512i idx1 = _mm512_loadu_si512(windowindex + (block * 128) + 64);
+			const __m512i taps0 = _mm512_mask_blend_epi8(_mm512_movepi8_mask(idx0), _mm512_permutex2var_epi8(s0, idx0, s1), _mm512_permutex2var_epi8(s2, idx0, s3));
+			const __m512i taps1 = _mm512_mask_blend_epi8(_mm512_movepi8_mask(idx1), _mm512_permutex2var_epi8(s0, idx1, s1), _mm512_permutex2var_epi8(s2, idx1, s3));
+			const __m512 w0 = _mm512_loadu_ps(weight0 + i);
+			const __m512 w1 = _mm512_loadu_ps(weight1 + i);
+
+			const __m512 a0 = BytesToFloat16(_mm512_castsi512_si128(taps0));
+			const __m512 a1 = BytesToFloat16(_mm512_extracti32x4_epi32(taps0, 1));
+			const __m512 a2 = BytesToFloat16(_mm512_extracti32x4_epi32(taps0, 2));
+			const __m512 b0 = BytesToFloat16(_mm512_extracti32x4_epi32(taps0, 3));
+			const __m512 b1 = BytesToFloat16(_mm512_castsi512_si128(taps1));
+			const __m512 b2 = BytesToFloat16(_mm512_extracti32x4_epi32(taps1, 1));
+			__m512 p0, p1, p2;
+			if (yuyv)
+			{
+				const __m512 outside = _mm512_sub_ps(one, _mm512_add_ps(w0, w1));
+				p0 = FillBlend16(v16, outside, a0, w0, b0, w1);
+				p1 = FillBlend16(v128, outside, a1, w0, b1, w1);
+				p2 = FillBlend16(v128, outside, a2, w0, b2, w1);
+			}
+			else
+			{
+				p0 = Blend16(a0, w0, b0, w1);
+				p1 = Blend16(a1, w0, b1, w1);
+				p2 = Blend16(a2, w0, b2, w1);
+			}
+			_mm512_storeu_ps(plane0 + i, p0);
+			_mm512_storeu_ps(plane1 + i, p1);
+			_mm512_storeu_ps(plane2 + i, p2);
+		}
+	}
+
+	PREPROCESS_TARGET("avx2")
+	void BlendRowsFloatAVX2(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, const float add, float* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const __m256 w0 = _mm256_set1_ps(weight0);
+		const __m256 w1 = _mm256_set1_ps(weight1);
+		const __m256 vadd = _mm256_set1_ps(add);
+		int32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row0 + i), w0), _mm256_mul_ps(_mm256_loadu_ps(row1 + i), w1)), vadd);
+			const __m256 g = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row0 + planesize + i), w0), _mm256_mul_ps(_mm256_loadu_ps(row1 + planesize + i), w1)), vadd);
+			const __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row0 + (planesize * 2) + i), w0), _mm256_mul_ps(_mm256_loadu_ps(row1 + (planesize * 2) + i), w1)), vadd);
+			StoreRGB8AVX2(out + (i * pixelstride), outplanesize, r, g, b);
+		}
+		BlendRowsFloatScalar(row0 + i, row1 + i, planesize, count - i, weight0, weight1, add, out + (i * pixelstride), outplanesize);
+	}
+
+	PREPROCESS_TARGET("avx2")
+	void BlendRowsUint8AVX2(const float* row0, const float* row1, const int64_t planesize, const int32_t count, const float weight0, const float weight1, uint8_t* out, const int64_t outplanesize)
+	{
+		const int64_t pixelstride = (outplanesize == 0) ? 3 : 1;
+		const __m256 w0 = _mm256_set1_ps(weight0);
+		const __m256 w1 = _mm256_set1_ps(weight1);
+		int32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row0 + i), w0), _mm256_mul_ps(_mm256_loadu_ps(row1 + i), w1));
+			const __m256 g = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row0 + planesize + i), w0), _mm256_mul_ps(_mm256_loadu_ps(row1 + planesize + i), w1));
+			const __m256 b = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row0 + (planesize * 2) + i), w0), _mm256_mul_ps(_mm256_loadu_ps(row1 + (planesize * 2) + i), w1));
+			StoreRGB8Uint8AVX2(out + (i * pixelstride), outplanesize, r, g, b);
+		}
+		BlendRowsUint8Scalar(row0 + i, row1 + i, planesize, count - i, weight0, weight1, out + (i * pixelstride), outplanesize);
+	}
+
+	PREPROCESS_TARGET("avx,f16c")
+	void FloatToHalfF16C(const float* in, uint16_t* out, const int64_t count)
+	{
+		int64_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+		}
+		for (; i < count; i++)
+		{
+			out[i] = FloatToHalfValue(in[i]);
+		}
+	}
+
+	PREPROCESS_TARGET("avx,f16c")
+	void HalfToFloatF16C(const uint16_t* in, float* out, const int64_t count)
+	{
+		int64_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+		}
+		for (; i < count; i++)
+		{
+			out[i] = HalfToFloatValue(in[i]);
+		}
+	}
+
+	struct CPUFeatures
+	{
+		bool m_sse41{ false };
+		bool m_avx2{ false };
+		bool m_avx512f{ false };
+		bool m_avx512vbmi{ false };		// with avx512bw, byte permutes for lut lookups
+		bool m_f16c{ false };
+
+		CPUFeatures()
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_cpu_init();
+			m_sse41 = __builtin_cpu_supports("sse4.1");
+			m_avx2 = __builtin_cpu_supports("avx2");
+			m_avx512f = __builtin_cpu_supports("avx512f");
+			m_avx512vbmi = m_avx512f && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi");
+			m_f16c = __builtin_cpu_supports("f16c");
+#elif defined(_MSC_VER)
+			int info[4] = { 0 };
+			__cpuid(info, 0);
+			const int maxleaf = info[0];
+			__cpuid(info, 1);
+			m_sse41 = (info[2] & (1 << 19)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+			const bool osavx = (xcr0 & 0x06) == 0x06;			// xmm and ymm state saved by OS
+			const bool osavx512 = (xcr0 & 0xe6) == 0xe6;		// opmask and zmm state saved by OS
+			m_f16c = osavx && (info[2] & (1 << 29)) != 0;
+			if (maxleaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				m_avx2 = osavx && (info[1] & (1 << 5)) != 0;
+				m_avx512f = osavx512 && (info[1] & (1 << 16)) != 0;
+				m_avx512vbmi = m_avx512f && (info[1] & (1 << 30)) != 0 && (info[2] & (1 << 1)) != 0;
+			}
+#endif
+		}
+	};
+
+	const CPUFeatures& GetCPUFeatures()
+	{
+		static const CPUFeatures features;
+		return features;
+	}
+
+#endif	// PREPROCESS_X86
+
+	void ApplyLUT(uint8_t* data, const int64_t count, const uint8_t* lut, const PreprocessKernel kernel)
+	{
+#ifdef PREPROCESS_X86
+		if (kernel == PREPROCESS_KERNEL_AVX512 && GetCPUFeatures().m_avx512vbmi)
+		{
+			ApplyLUTAVX512VBMI(data, count, lut);
+			return;
+		}
+#endif
+		ApplyLUTScalar(data, count, lut);
+	}
+
+}	// namespace
+
+PreprocessKernel GetBestPreprocessKernel()
+{
+	static const PreprocessKernel best = IsPreprocessKernelSupported(PREPROCESS_KERNEL_AVX512) ? PREPROCESS_KERNEL_AVX512 :
+		IsPreprocessKernelSupported(PREPROCESS_KERNEL_AVX2) ? PREPROCESS_KERNEL_AVX2 :
+		IsPreprocessKernelSupported(PREPROCESS_KERNEL_SSE41) ? PREPROCESS_KERNEL_SSE41 : PREPROCESS_KERNEL_SCALAR;
+	return best;
+}
+
+bool IsPreprocessKernelSupported(const PreprocessKernel kernel)
+{
+	switch (kernel)
+	{
+	case PREPROCESS_KERNEL_AUTO:
+	case PREPROCESS_KERNEL_SCALAR:
+		return true;
+#ifdef PREPROCESS_X86
+	case PREPROCESS_KERNEL_SSE41:
+		return GetCPUFeatures().m_sse41;
+	case PREPROCESS_KERNEL_AVX2:
+		return GetCPUFeatures().m_avx2;
+	case PREPROCESS_KERNEL_AVX512:
+		return GetCPUFeatures().m_avx512f;
+#endif
+	default:
+		return false;
+	}
+}
+
+void BGRToRGBFloat(const uint8_t* bgr, float* rgb, const int64_t pixels, const float scale, const float add, const PreprocessKernel kernel)
+{
+	switch ((kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel)
+	{
+#ifdef PREPROCESS_X86
+	case PREPROCESS_KERNEL_SSE41:
+		BGRToRGBFloatSSE41(bgr, rgb, pixels, scale, add);
+		break;
+	case PREPROCESS_KERNEL_AVX2:
+		BGRToRGBFloatAVX2(bgr, rgb, pixels, scale, add);
+		break;
+	case PREPROCESS_KERNEL_AVX512:
+		BGRToRGBFloatAVX512(bgr, rgb, pixels, scale, add);
+		break;
+#endif
+	default:
+		BGRToRGBFloatScalar(bgr, rgb, pixels, scale, add);
+		break;
+	}
+}
+
+void BGRToRGBUint8(const uint8_t* bgr, uint8_t* rgb, const int64_t pixels, const uint8_t* lut, const PreprocessKernel kernel)
+{
+	const PreprocessKernel k = (kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel;
+#ifdef PREPROCESS_X86
+	if (lut == nullptr && k != PREPROCESS_KERNEL_SCALAR)
+	{
+		BGRToRGBUint8SSSE3(bgr, rgb, pixels);
+		return;
+	}
+	if (lut != nullptr && k == PREPROCESS_KERNEL_AVX512 && GetCPUFeatures().m_avx512vbmi)
+	{
+		// swap while the row is read, then look up in place while it's still in cache
+		BGRToRGBUint8SSSE3(bgr, rgb, pixels);
+		ApplyLUTAVX512VBMI(rgb, pixels * 3, lut);
+		return;
+	}
+#endif
+	BGRToRGBUint8Scalar(bgr, rgb, pixels, lut);
+}
+
+void YUYVToRGBFloat(const uint8_t* yuyv, float* rgb, const int64_t pixels, const float scale, const float add, const PreprocessKernel kernel)
+{
+	const PreprocessKernel k = (kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel;
+#ifdef PREPROCESS_X86
+	if (k == PREPROCESS_KERNEL_AVX2 || k == PREPROCESS_KERNEL_AVX512)
+	{
+		YUYVToRGBFloatAVX2(yuyv, rgb, pixels, scale, add);
+		return;
+	}
+#endif
+	YUYVToRGBFloatScalar(yuyv, rgb, pixels, scale, add);
+}
+
+void FloatToHalf(const float* in, uint16_t* out, const int64_t count, const PreprocessKernel kernel)
+{
+	const PreprocessKernel k = (kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel;
+#ifdef PREPROCESS_X86
+	if ((k == PREPROCESS_KERNEL_AVX2 || k == PREPROCESS_KERNEL_AVX512) && GetCPUFeatures().m_f16c)
+	{
+		FloatToHalfF16C(in, out, count);
+		return;
+	}
+#endif
+	FloatToHalfScalar(in, out, count);
+}
+
+void HalfToFloat(const uint16_t* in, float* out, const int64_t count, const PreprocessKernel kernel)
+{
+	const PreprocessKernel k = (kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel;
+#ifdef PREPROCESS_X86
+	if ((k == PREPROCESS_KERNEL_AVX2 || k == PREPROCESS_KERNEL_AVX512) && GetCPUFeatures().m_f16c)
+	{
+		HalfToFloatF16C(in, out, count);
+		return;
+	}
+#endif
+	HalfToFloatScalar(in, out, count);
+}
+
+bool BuildNormalizeLUT(std::array<uint8_t, 256>& lut, const float div, const float add)
+{
+	bool identity = true;
+	for (int32_t i = 0; i < 256; i++)
+	{
+		float v = (div != 0.0f) ? (static_cast<float>(i) / div) + add : static_cast<float>(i) + add;
+		v = (v < 0.0f) ? 0.0f : ((v > 255.0f) ? 255.0f : v);
+		lut[i] = static_cast<uint8_t>(v);
+		if (lut[i] != i)
+		{
+			identity = false;
+		}
+	}
+	return !identity;
+}
+
+void BuildQuantizeLUT(std::array<uint8_t, 256>& lut, const float div, const float add, const float scale, const int32_t zeropoint)
+{
+	for (int32_t i = 0; i < 256; i++)
+	{
+		const float v = (div != 0.0f) ? (static_cast<float>(i) / div) + add : static_cast<float>(i) + add;
+		const int32_t q = std::clamp(static_cast<int32_t>(std::lround(v / scale)) + zeropoint, -128, 127);
+		lut[i] = static_cast<uint8_t>(static_cast<int8_t>(q));
+	}
+}
+
+CropResizePreprocessor::CropResizePreprocessor() :m_srcwidth(0), m_srcheight(0), m_cropx(0), m_cropy(0), m_cropsize(0), m_outsize(0), m_format(PIXEL_FORMAT_BGR), m_layout(TENSOR_LAYOUT_NHWC), m_xgathercount(0)
+{
+
+}
+
+CropResizePreprocessor::~CropResizePreprocessor()
+{
+
+}
+
+void CropResizePreprocessor::SetGeometry(const int32_t srcwidth, const int32_t srcheight, const int32_t cropx, const int32_t cropy, const int32_t cropsize, const int32_t outsize, const PixelFormat format, const TensorLayout layout)
+{
+	// the layout only changes where the vertical pass writes
+	m_layout = layout;
+
+	if (srcwidth == m_srcwidth && srcheight == m_srcheight && cropx == m_cropx && cropy == m_cropy && cropsize == m_cropsize && outsize == m_outsize && format == m_format)
+	{
+		return;
+	}
+
+	m_srcwidth = srcwidth;
+	m_srcheight = srcheight;
+	m_cropx = cropx;
+	m_cropy = cropy;
+	m_cropsize = cropsize;
+	m_outsize = outsize;
+	m_format = format;
+
+	BuildTaps(m_xtaps, srcwidth, cropx, cropsize, outsize, (format == PIXEL_FORMAT_YUYV) ? 1 : 3);
+	BuildTaps(m_ytaps, srcheight, cropy, cropsize, outsize, 1);
+
+	// the taps only move right, so the ones loading past the end of the row are all at the end
+	m_xgathercount = static_cast<int32_t>(m_xtaps.m_index1.size());
+	if (format == PIXEL_FORMAT_BGR)
+	{
+		while (m_xgathercount > 0 && m_xtaps.m_index1[m_xgathercount - 1] + 4 > srcwidth * 3)
+		{
+			m_xgathercount--;
+		}
+	}
+
+	// 16 pixel blocks for the AVX512-VBMI horizontal pass, while each block's taps fit in a 256 byte window that stays inside the row
+	// the bytes of each tap in plane order, R G B for BGR and Y U V for YUYV where U and V are in the tap's pixel pair
+	auto tapbyte = [format](const int32_t index, const int32_t plane)
+	{
+		return (format == PIXEL_FORMAT_YUYV) ? ((plane == 0) ? index * 2 : ((index & ~1) * 2) + (plane * 2) - 1) : index + 2 - plane;
+	};
+	const int32_t rowbytes = srcwidth * ((format == PIXEL_FORMAT_YUYV) ? 2 : 3);
+	m_xwindowstart.clear();
+	m_xwindowindex.clear();
+	for (int32_t block = 0; block + 16 <= outsize; block += 16)
+	{
+		const int32_t start = std::min({ tapbyte(m_xtaps.m_index0[block], 0), tapbyte(m_xtaps.m_index0[block], 1), tapbyte(m_xtaps.m_index0[block], 2) });
+		const int32_t end = std::max({ tapbyte(m_xtaps.m_index1[block + 15], 0), tapbyte(m_xtaps.m_index1[block + 15], 1), tapbyte(m_xtaps.m_index1[block + 15], 2) }) + 1;
+		if (end - start > 256 || start + 256 > rowbytes)
+		{
+			break;
+		}
+		m_xwindowstart.push_back(start);
+		for (int32_t tap = 0; tap < 2; tap++)
+		{
+			const std::vector<int32_t>& index = (tap == 0) ? m_xtaps.m_index0 : m_xtaps.m_index1;
+			for (int32_t plane = 0; plane < 3; plane++)
+			{
+				for (int32_t i = 0; i < 16; i++)
+				{
+					m_xwindowindex.push_back(static_cast<uint8_t>(tapbyte(index[block + i], plane) - start));
+				}
+			}
+		}
+		m_xwindowindex.resize(m_xwindowindex.size() + 32, 0);
+	}
+
+	m_rows.assign(outsize > 0 ? static_cast<size_t>(outsize) * 6 : 0, 0.0f);
+}
+
+void CropResizePreprocessor::BuildTaps(Taps& taps, const int32_t srclength, const int32_t cropstart, const int32_t cropsize, const int32_t outsize, const int32_t stride) const
+{
+	const size_t count = outsize > 0 ? outsize : 0;
+	taps.m_index0.assign(count, 0);
+	taps.m_index1.assign(count, 0);
+	taps.m_weight0.assign(count, 0.0f);
+	taps.m_weight1.assign(count, 0.0f);
+	if (srclength < 1 || cropsize < 1 || outsize < 1)
+	{
+		return;
+	}
+
+	// same pixel center mapping as cv::resize with INTER_LINEAR
+	const float scale = static_cast<float>(cropsize) / static_cast<float>(outsize);
+	for (int32_t i = 0; i < outsize; i++)
+	{
+		const float src = ((static_cast<float>(i) + 0.5f) * scale) - 0.5f + static_cast<float>(cropstart);
+		const float srcfloor = std::floor(src);
+		const float frac = src - srcfloor;
+		const int32_t i0 = static_cast<int32_t>(srcfloor);
+		const int32_t i1 = i0 + 1;
+
+		taps.m_weight0[i] = (i0 >= 0 && i0 < srclength) ? 1.0f - frac : 0.0f;
+		taps.m_weight1[i] = (i1 >= 0 && i1 < srclength) ? frac : 0.0f;
+		taps.m_index0[i] = std::clamp(i0, 0, srclength - 1) * stride;
+		taps.m_index1[i] = std::clamp(i1, 0, srclength - 1) * stride;
+	}
+}
+
+bool CropResizePreprocessor::IsDirectCopy() const
+{
+	// a YUYV row has to start on the first pixel of a pair, and the copy kernels only write interleaved RGB
+	return m_layout == TENSOR_LAYOUT_NHWC && m_cropsize == m_outsize && m_cropx >= 0 && m_cropy >= 0 && (m_cropx + m_cropsize) <= m_srcwidth && (m_cropy + m_cropsize) <= m_srcheight &&
+		(m_format != PIXEL_FORMAT_YUYV || (m_cropx & 1) == 0);
+}
+
+const float* CropResizePreprocessor::FilterRow(const uint8_t* src, const int64_t srcstride, const int32_t srcrow, const int32_t keep, std::array<int32_t, 2>& cachedrows, const PreprocessKernel kernel) const
+{
+	for (size_t i = 0; i < cachedrows.size(); i++)
+	{
+		if (cachedrows[i] == srcrow)
+		{
+			return m_rows.data() + (i * m_outsize * 3);
+		}
+	}
+
+	const size_t slot = (cachedrows[0] == keep) ? 1 : 0;
+	cachedrows[slot] = srcrow;
+	float* planes = m_rows.data() + (slot * m_outsize * 3);
+	const uint8_t* row = src + (srcrow * srcstride);
+	float* plane0 = planes;
+	float* plane1 = planes + m_outsize;
+	float* plane2 = planes + (m_outsize * 2);
+
+	// the blocks the byte permutes handle, then the rest of the row
+	int32_t done = 0;
+#ifdef PREPROCESS_X86
+	if (kernel == PREPROCESS_KERNEL_AVX512 && GetCPUFeatures().m_avx512vbmi)
+	{
+		FilterRowWindowAVX512VBMI(row, m_xwindowstart.data(), m_xwindowindex.data(), static_cast<int32_t>(m_xwindowstart.size()), m_xtaps.m_weight0.data(), m_xtaps.m_weight1.data(), m_format == PIXEL_FORMAT_YUYV, plane0, plane1, plane2);
+		done = static_cast<int32_t>(m_xwindowstart.size()) * 16;
+	}
+#endif
+	const int32_t* index0 = m_xtaps.m_index0.data() + done;
+	const int32_t* index1 = m_xtaps.m_index1.data() + done;
+	const float* weight0 = m_xtaps.m_weight0.data() + done;
+	const float* weight1 = m_xtaps.m_weight1.data() + done;
+	const int32_t count = m_outsize - done;
+
+	if (m_format == PIXEL_FORMAT_YUYV)
+	{
+#ifdef PREPROCESS_X86
+		if (kernel == PREPROCESS_KERNEL_AVX2 || kernel == PREPROCESS_KERNEL_AVX512)
+		{
+			FilterRowYUYVAVX2(row, index0, index1, weight0, weight1, count, plane0 + done, plane1 + done, plane2 + done);
+			return planes;
+		}
+#endif
+		FilterRowYUYVScalar(row, index0, index1, weight0, weight1, count, plane0 + done, plane1 + done, plane2 + done);
+		return planes;
+	}
+
+#ifdef PREPROCESS_X86
+	if (kernel == PREPROCESS_KERNEL_AVX2 || kernel == PREPROCESS_KERNEL_AVX512)
+	{
+		FilterRowBGRAVX2(row, index0, index1, weight0, weight1, count, m_xgathercount - done, plane0 + done, plane1 + done, plane2 + done);
+		return planes;
+	}
+#endif
+	FilterRowBGRScalar(row, index0, index1, weight0, weight1, count, plane0 + done, plane1 + done, plane2 + done);
+	return planes;
+}
+
+void CropResizePreprocessor::Process(const uint8_t* src, const int64_t srcstride, float* rgb, const float scale, const float add, const PreprocessKernel kernel) const
+{
+	const PreprocessKernel k = (kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel;
+#ifdef PREPROCESS_X86
+	const bool avx2 = (k == PREPROCESS_KERNEL_AVX2 || k == PREPROCESS_KERNEL_AVX512);
+#endif
+
+	if (IsDirectCopy())
+	{
+		// no scaling - each row of the crop goes straight through the SIMD kernel
+		for (int32_t y = 0; y < m_outsize; y++)
+		{
+			float* out = rgb + (static_cast<int64_t>(y) * m_outsize * 3);
+			if (m_format == PIXEL_FORMAT_YUYV)
+			{
+				YUYVToRGBFloat(src + ((m_cropy + y) * srcstride) + (m_cropx * 2LL), out, m_outsize, scale, add, k);
+			}
+			else
+			{
+				BGRToRGBFloat(src + ((m_cropy + y) * srcstride) + (m_cropx * 3LL), out, m_outsize, scale, add, k);
+			}
+		}
+		return;
+	}
+
+	// source rows are only filtered again when the next output row moves past them
+	// an NCHW output row is the start of its R plane's row, NHWC rows are interleaved
+	const int64_t outplanesize = (m_layout == TENSOR_LAYOUT_NCHW) ? static_cast<int64_t>(m_outsize) * m_outsize : 0;
+	const int64_t outrowstride = (m_layout == TENSOR_LAYOUT_NCHW) ? m_outsize : m_outsize * 3LL;
+	std::array<int32_t, 2> cachedrows{ -1, -1 };
+	for (int32_t y = 0; y < m_outsize; y++)
+	{
+		const float* row0 = FilterRow(src, srcstride, m_ytaps.m_index0[y], m_ytaps.m_index1[y], cachedrows, k);
+		const float* row1 = FilterRow(src, srcstride, m_ytaps.m_index1[y], m_ytaps.m_index0[y], cachedrows, k);
+		const float wy0 = m_ytaps.m_weight0[y];
+		const float wy1 = m_ytaps.m_weight1[y];
+		float* out = rgb + (y * outrowstride);
+#ifdef PREPROCESS_X86
+		if (avx2 && m_format == PIXEL_FORMAT_YUYV)
+		{
+			BlendRowsYUYVFloatAVX2(row0, row1, m_outsize, m_outsize, wy0, wy1, scale, add, out, outplanesize);
+		}
+		else if (avx2)
+		{
+			BlendRowsFloatAVX2(row0, row1, m_outsize, m_outsize, wy0 * scale, wy1 * scale, add, out, outplanesize);
+		}
+		else
+#endif
+		if (m_format == PIXEL_FORMAT_YUYV)
+		{
+			BlendRowsYUYVFloatScalar(row0, row1, m_outsize, m_outsize, wy0, wy1, scale, add, out, outplanesize);
+		}
+		else
+		{
+			BlendRowsFloatScalar(row0, row1, m_outsize, m_outsize, wy0 * scale, wy1 * scale, add, out, outplanesize);
+		}
+	}
+}
+
+void CropResizePreprocessor::Process(const uint8_t* src, const int64_t srcstride, uint8_t* rgb, const uint8_t* lut, const PreprocessKernel kernel) const
+{
+	const PreprocessKernel k = (kernel == PREPROCESS_KERNEL_AUTO) ? GetBestPreprocessKernel() : kernel;
+#ifdef PREPROCESS_X86
+	const bool avx2 = (k == PREPROCESS_KERNEL_AVX2 || k == PREPROCESS_KERNEL_AVX512);
+#endif
+
+	// there's no YUYV to uint8 kernel, a direct copy of YUYV goes through the row passes with weights of 1
+	if (IsDirectCopy() && m_format != PIXEL_FORMAT_YUYV)
+	{
+		for (int32_t y = 0; y < m_outsize; y++)
+		{
+			BGRToRGBUint8(src + ((m_cropy + y) * srcstride) + (m_cropx * 3LL), rgb + (static_cast<int64_t>(y) * m_outsize * 3), m_outsize, lut, k);
+		}
+		return;
+	}
+
+	const int64_t outplanesize = (m_layout == TENSOR_LAYOUT_NCHW) ? static_cast<int64_t>(m_outsize) * m_outsize : 0;
+	const int64_t outrowstride = (m_layout == TENSOR_LAYOUT_NCHW) ? m_outsize : m_outsize * 3LL;
+	std::array<int32_t, 2> cachedrows{ -1, -1 };
+	for (int32_t y = 0; y < m_outsize; y++)
+	{
+		const float* row0 = FilterRow(src, srcstride, m_ytaps.m_index0[y], m_ytaps.m_index1[y], cachedrows, k);
+		const float* row1 = FilterRow(src, srcstride, m_ytaps.m_index1[y], m_ytaps.m_index0[y], cachedrows, k);
+		const float wy0 = m_ytaps.m_weight0[y];
+		const float wy1 = m_ytaps.m_weight1[y];
+		uint8_t* out = rgb + (y * outrowstride);
+#ifdef PREPROCESS_X86
+		if (avx2 && m_format == PIXEL_FORMAT_YUYV)
+		{
+			BlendRowsYUYVUint8AVX2(row0, row1, m_outsize, m_outsize, wy0, wy1, out, outplanesize);
+		}
+		else if (avx2)
+		{
+			BlendRowsUint8AVX2(row0, row1, m_outsize, m_outsize, wy0, wy1, out, outplanesize);
+		}
+		else
+#endif
+		if (m_format == PIXEL_FORMAT_YUYV)
+		{
+			BlendRowsYUYVUint8Scalar(row0, row1, m_outsize, m_outsize, wy0, wy1, out, outplanesize);
+		}
+		else
+		{
+			BlendRowsUint8Scalar(row0, row1, m_outsize, m_outsize, wy0, wy1, out, outplanesize);
+		}
+	}
+
+	if (lut)
+	{
+		// looked up once over the whole tensor, the vectorized lookup needs AVX512-VBMI like BGRToRGBUint8
+		ApplyLUT(rgb, static_cast<int64_t>(m_outsize) * m_outsize * 3, lut, k);
+	}
+}
+
+float CropResizePreprocessor::Scale() const
+{
+	return (m_outsize > 0) ? static_cast<float>(m_cropsize) / static_cast<float>(m_outsize) : 1.0f;
+}
+
+int32_t CropResizePreprocessor::CropX() const
+{
+	return m_cropx;
+}
+
+int32_t CropResizePreprocessor::CropY() const
+{
+	return m_cropy;
+}
+
+void GetCenterCrop(const int32_t width, const int32_t height, int32_t& cropx, int32_t& cropy, int32_t& cropsize)
+{
+	cropsize = std::min(width, height);
+	cropx = (width - cropsize) / 2;
+	cropy = (height - cropsize) / 2;
+}
+
+void GetFullFrameCrop(const int32_t width, const int32_t height, int32_t& cropx, int32_t& cropy, int32_t& cropsize)
+{
+	cropsize = std::max(width, height);
+	cropx = (width - cropsize) / 2;
+	cropy = (height - cropsize) / 2;
+}
+
+bool GetPoseCrop(const PoseDetection& posedetection, const int32_t width, const int32_t height, const float minscore, int32_t& cropx, int32_t& cropy, int32_t& cropsize)
+{
+	// https://www.tensorflow.org/hub/tutorials/movenet#cropping_algorithm
+	const std::array<KeypointLocation, 2> hips{ KEYPOINT_LEFT_HIP, KEYPOINT_RIGHT_HIP };
+	const std::array<KeypointLocation, 4> torso{ KEYPOINT_LEFT_HIP, KEYPOINT_RIGHT_HIP, KEYPOINT_LEFT_SHOULDER, KEYPOINT_RIGHT_SHOULDER };
+
+	const std::array<KeypointDetection, KEYPOINT_MAX>& keypoints = posedetection.m_keypoints;
+	const bool hipvisible = keypoints[KEYPOINT_LEFT_HIP].m_score >= minscore || keypoints[KEYPOINT_RIGHT_HIP].m_score >= minscore;
+	const bool shouldervisible = keypoints[KEYPOINT_LEFT_SHOULDER].m_score >= minscore || keypoints[KEYPOINT_RIGHT_SHOULDER].m_score >= minscore;
+	if (!hipvisible || !shouldervisible || width < 1 || height < 1)
+	{
+		return false;
+	}
+
+	// centered on the visible hips
+	float centerx = 0;
+	float centery = 0;
+	float count = 0;
+	for (std::array<KeypointLocation, 2>::const_iterator i = hips.begin(); i != hips.end(); i++)
+	{
+		if (keypoints[(*i)].m_score >= minscore)
+		{
+			centerx += keypoints[(*i)].m_pos.m_x;
+			centery += keypoints[(*i)].m_pos.m_y;
+			count++;
+		}
+	}
+	centerx /= count;
+	centery /= count;
+
+	float torsorange = 0;
+	for (std::array<KeypointLocation, 4>::const_iterator i = torso.begin(); i != torso.end(); i++)
+	{
+		if (keypoints[(*i)].m_score >= minscore)
+		{
+			torsorange = std::max(torsorange, std::max(std::abs(keypoints[(*i)].m_pos.m_x - centerx), std::abs(keypoints[(*i)].m_pos.m_y - centery)));
+		}
+	}
+
+	float bodyrange = 0;
+	for (int32_t i = KEYPOINT_NOSE; i < KEYPOINT_MAX; i++)
+	{
+		if (keypoints[i].m_score >= minscore)
+		{
+			bodyrange = std::max(bodyrange, std::max(std::abs(keypoints[i].m_pos.m_x - centerx), std::abs(keypoints[i].m_pos.m_y - centery)));
+		}
+	}
+
+	// enough room for the torso and the limbs to move, but no further out than the farthest image edge
+	float halfsize = std::max(torsorange * 1.9f, bodyrange * 1.2f);
+	halfsize = std::min(halfsize, std::max(std::max(centerx, static_cast<float>(width) - centerx), std::max(centery, static_cast<float>(height) - centery)));
+	if (halfsize <= 0 || halfsize > static_cast<float>(std::max(width, height)) / 2.0f)
+	{
+		return false;
+	}
+
+	cropsize = static_cast<int32_t>(std::lround(halfsize * 2.0f));
+	cropx = static_cast<int32_t>(std::lround(centerx - halfsize));
+	cropy = static_cast<int32_t>(std::lround(centery - halfsize));
+	return cropsize > 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "posekeypointdata.h"
+
+/*
+
+	Kernels that convert an interleaved BGR 8 bit image (OpenCV default) into an interleaved RGB model input
+	The SIMD kernels are selected at runtime based on the CPU, falling back to scalar code on other CPUs/architectures
+
+	Raw YUYV camera frames are converted to RGB with the BT.601 limited range coefficients OpenCV uses for COLOR_YUV2BGR_YUYV
+
+*/
+
+enum PreprocessKernel
+{
+	PREPROCESS_KERNEL_AUTO = 0,		// best kernel supported by this CPU
+	PREPROCESS_KERNEL_SCALAR,
+	PREPROCESS_KERNEL_SSE41,
+	PREPROCESS_KERNEL_AVX2,
+	PREPROCESS_KERNEL_AVX512,
+	PREPROCESS_KERNEL_MAX
+};
+
+extern std::array<std::string, PreprocessKernel::PREPROCESS_KERNEL_MAX> PreprocessKernelName;
+
+enum PixelFormat
+{
+	PIXEL_FORMAT_BGR = 0,			// 3 bytes per pixel
+	PIXEL_FORMAT_YUYV,				// 4:2:2, 2 bytes per pixel with each pair of pixels sharing U and V
+	PIXEL_FORMAT_MAX
+};
+
+enum TensorLayout
+{
+	TENSOR_LAYOUT_NHWC = 0,			// interleaved RGB, TensorFlow models
+	TENSOR_LAYOUT_NCHW,				// R, G and B planes, PyTorch models and many ONNX conversions
+	TENSOR_LAYOUT_MAX
+};
+
+extern std::array<std::string, TensorLayout::TENSOR_LAYOUT_MAX> TensorLayoutName;
+
+PreprocessKernel GetBestPreprocessKernel();
+bool IsPreprocessKernelSupported(const PreprocessKernel kernel);
+
+// rgb = (bgr * scale) + add for each channel, with B and R swapped
+void BGRToRGBFloat(const uint8_t* bgr, float* rgb, const int64_t pixels, const float scale, const float add, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO);
+
+// rgb = lut[bgr] for each channel, with B and R swapped - a null lut copies the values unchanged
+// the lookup is only vectorized with the AVX-512 kernel on CPUs with AVX512-VBMI, the channel swap with every SIMD kernel
+void BGRToRGBUint8(const uint8_t* bgr, uint8_t* rgb, const int64_t pixels, const uint8_t* lut, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO);
+
+// rgb = (yuv to rgb * scale) + add, yuyv must start on the first pixel of a pair
+void YUYVToRGBFloat(const uint8_t* yuyv, float* rgb, const int64_t pixels, const float scale, const float add, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO);
+
+// IEEE half precision for FP16 model inputs, uses F16C with the AVX2 and AVX-512 kernels when the CPU has it
+void FloatToHalf(const float* in, uint16_t* out, const int64_t count, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO);
+
+// float from IEEE half precision for FP16 model outputs, uses F16C with the AVX2 and AVX-512 kernels when the CPU has it
+void HalfToFloat(const uint16_t* in, float* out, const int64_t count, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO);
+
+// lut for BGRToRGBUint8 from the same divide/add normalization used for float input, returns false if the lut would leave values unchanged
+bool BuildNormalizeLUT(std::array<uint8_t, 256>& lut, const float div, const float add);
+// lut for INT8 inputs, the normalized value quantized with the model's scale and zero point, stored as the int8 bit pattern
+void BuildQuantizeLUT(std::array<uint8_t, 256>& lut, const float div, const float add, const float scale, const int32_t zeropoint);
+
+/*
+
+	Samples a square crop of a BGR or YUYV image with bilinear filtering and writes the normalized RGB model input directly, interleaved for NHWC or as planes for NCHW
+	This replaces cropping and resizing into an intermediate image followed by a second pass to fill the input tensor
+	The filter is separable, each source row that's needed is filtered horizontally once into a float row buffer and each output row blends two of those
+	The AVX2 and AVX-512 kernels gather the horizontal taps and blend the rows 8 pixels at a time, the SSE4.1 kernel uses the scalar passes
+	With AVX512-VBMI the horizontal taps are picked out of the row with byte permutes instead of gathers where 16 pixels' taps fit in 256 bytes
+	YUYV is interpolated into Y, U and V rows and converted to RGB in the vertical pass, the same as converting first since the conversion is linear
+	The vertical pass writes either layout, NCHW only skips the direct copy of an unscaled crop since those kernels write interleaved RGB
+	The sampling table is only rebuilt when the geometry changes, parts of the crop outside the image are filled with black
+
+*/
+
+class CropResizePreprocessor
+{
+public:
+	CropResizePreprocessor();
+	~CropResizePreprocessor();
+
+	// crop is in source pixels and may extend past the image edges
+	void SetGeometry(const int32_t srcwidth, const int32_t srcheight, const int32_t cropx, const int32_t cropy, const int32_t cropsize, const int32_t outsize, const PixelFormat format = PIXEL_FORMAT_BGR, const TensorLayout layout = TENSOR_LAYOUT_NHWC);
+
+	// src is in the format passed to SetGeometry, rgb is written in its layout
+	void Process(const uint8_t* src, const int64_t srcstride, float* rgb, const float scale, const float add, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO) const;
+	void Process(const uint8_t* src, const int64_t srcstride, uint8_t* rgb, const uint8_t* lut, const PreprocessKernel kernel = PREPROCESS_KERNEL_AUTO) const;
+
+	float Scale() const;		// source pixels per output pixel
+	int32_t CropX() const;
+	int32_t CropY() const;
+
+private:
+
+	// one entry per output column or row, in separate arrays so the SIMD kernels can load 8 at a time
+	struct Taps
+	{
+		std::vector<int32_t> m_index0;		// source column (in bytes) or row
+		std::vector<int32_t> m_index1;
+		std::vector<float> m_weight0;		// 0 when the source pixel is outside of the image
+		std::vector<float> m_weight1;
+	};
+
+	void BuildTaps(Taps& taps, const int32_t srclength, const int32_t cropstart, const int32_t cropsize, const int32_t outsize, const int32_t stride) const;
+	bool IsDirectCopy() const;
+	// source row filtered horizontally into 3 planes of m_outsize floats, cached in whichever buffer doesn't hold row keep
+	const float* FilterRow(const uint8_t* src, const int64_t srcstride, const int32_t srcrow, const int32_t keep, std::array<int32_t, 2>& cachedrows, const PreprocessKernel kernel) const;
+
+	int32_t m_srcwidth;
+	int32_t m_srcheight;
+	int32_t m_cropx;
+	int32_t m_cropy;
+	int32_t m_cropsize;
+	int32_t m_outsize;
+	PixelFormat m_format;
+	TensorLayout m_layout;
+	Taps m_xtaps;								// source column in bytes for BGR, in pixels for YUYV
+	Taps m_ytaps;
+	int32_t m_xgathercount;						// leading x taps whose 4 byte SIMD loads stay inside the source row
+	std::vector<int32_t> m_xwindowstart;		// byte offset of each 16 pixel block the AVX512-VBMI pass handles
+	std::vector<uint8_t> m_xwindowindex;		// and its 128 bytes of permute indices
+	mutable std::vector<float> m_rows;			// the two horizontally filtered rows FilterRow caches, so a preprocessor can't be shared between threads
+
+};
+
+// largest centered square of the image
+void GetCenterCrop(const int32_t width, const int32_t height, int32_t& cropx, int32_t& cropy, int32_t& cropsize);
+
+// smallest centered square containing the whole image, padded on the short side
+void GetFullFrameCrop(const int32_t width, const int32_t height, int32_t& cropx, int32_t& cropy, int32_t& cropsize);
+
+// square around a pose detected in an earlier frame, MoveNet smart cropping
+// returns false when the torso isn't visible with at least minscore, crop is left unchanged
+bool GetPoseCrop(const PoseDetection& posedetection, const int32_t width, const int32_t height, const float minscore, int32_t& cropx, int32_t& cropy, int32_t& cropsize);
@@ -0,0 +1,366 @@
+#include "syntheticcapturethread.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include <opencv2/imgproc.hpp>
+
+SyntheticCaptureThread::SyntheticCaptureThread() :IThread(), m_framepool(nullptr), m_width(640), m_height(480), m_cyclelength(60), m_lastdelivered(0)
+{
+
+}
+
+SyntheticCaptureThread::~SyntheticCaptureThread()
+{
+
+}
+
+void SyntheticCaptureThread::FrameTaken()
+{
+	{
+		// empty lock so the notify can't slip in between the generator checking m_framepending and starting to wait
+		std::lock_guard<std::mutex> guard(m_takenmutex);
+	}
+	m_takencv.notify_one();
+}
+
+void SyntheticCaptureThread::Stop()
+{
+	IThread::Stop();
+	FrameTaken();
+}
+
+void SyntheticCaptureThread::Run(const IThread::ThreadParameters* threadparameters)
+{
+	try
+	{
+		const SyntheticCaptureThreadParameters params = *(dynamic_cast<const SyntheticCaptureThreadParameters*>(threadparameters));
+		m_sendframe = params.m_sendframe;
+		m_framepool = params.m_framepool;
+		{
+			std::lock_guard<std::mutex> guard(m_statsmutex);
+			m_width = std::max(params.m_width, 64);
+			m_height = std::max(params.m_height, 64);
+			m_cyclelength = (params.m_cliplength > 0) ? params.m_cliplength : 60;
+			m_lastdelivered = 0;
+		}
+
+		// one movement cycle drawn up front so sending a frame costs no more than a copy
+		std::vector<cv::Mat> clip(std::max(params.m_cliplength, 0));
+		PoseDetection pose;
+		for (size_t i = 0; i < clip.size(); i++)
+		{
+			SyntheticPose(i + 1, m_width, m_height, m_cyclelength, pose);
+			DrawFrame(pose, clip[i]);
+		}
+
+		// frames sent while the models are still loading would only be counted as dropped
+		while (!m_stop && params.m_ready && !params.m_ready())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		std::cout << "Generating " << m_width << "x" << m_height << " frames at " << ((params.m_fps > 0) ? std::to_string(params.m_fps) + " fps" : std::string("full speed")) << std::endl;
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point lastprint = start;
+		{
+			std::lock_guard<std::mutex> guard(m_statsmutex);
+			m_interval = Stats();
+			m_interval.m_start = start;
+			m_total = m_interval;
+		}
+
+		for (uint64_t sequence = 1; !m_stop && (params.m_frames == 0 || sequence <= params.m_frames); sequence++)
+		{
+			std::chrono::steady_clock::time_point timestamp;
+			if (params.m_fps > 0)
+			{
+				timestamp = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(static_cast<double>(sequence - 1) / params.m_fps));
+				if (!WaitUntil(timestamp))
+				{
+					break;
+				}
+			}
+			else
+			{
+				if (params.m_framepending)
+				{
+					std::unique_lock<std::mutex> lock(m_takenmutex);
+					m_takencv.wait(lock, [this, &params]() { return m_stop || !params.m_framepending(); });
+				}
+				if (m_stop)
+				{
+					break;
+				}
+				timestamp = std::chrono::steady_clock::now();
+			}
+
+			// at full speed nothing is dropped, wait for a buffer to come back
+			int32_t slot = m_framepool ? m_framepool->Acquire() : -1;
+			while (slot < 0 && m_framepool && params.m_fps <= 0 && !m_stop)
+			{
+				slot = m_framepool->Acquire(std::chrono::milliseconds(10));
+			}
+			if (m_stop)
+			{
+				if (slot >= 0)
+				{
+					m_framepool->Release(slot);
+				}
+				break;
+			}
+			if (slot >= 0)
+			{
+				if (!clip.empty())
+				{
+					clip[(sequence - 1) % clip.size()].copyTo(m_framepool->Frame(slot));
+				}
+				else
+				{
+					SyntheticPose(sequence, m_width, m_height, m_cyclelength, pose);
+					DrawFrame(pose, m_framepool->Frame(slot));
+				}
+				m_framepool->Sequence(slot) = sequence;
+				m_framepool->Timestamp(slot) = timestamp;
+			}
+
+			{
+				std::lock_guard<std::mutex> guard(m_statsmutex);
+				if (slot >= 0)
+				{
+					m_interval.m_sent++;
+					m_total.m_sent++;
+				}
+				else
+				{
+					m_interval.m_unsent++;
+					m_total.m_unsent++;
+				}
+			}
+
+			if (slot >= 0)
+			{
+				if (m_sendframe)
+				{
+					m_sendframe(slot);
+				}
+				else
+				{
+					m_framepool->Release(slot);
+				}
+			}
+
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (params.m_statsinterval > 0 && (now - lastprint) >= std::chrono::seconds(params.m_statsinterval))
+			{
+				Stats interval;
+				{
+					std::lock_guard<std::mutex> guard(m_statsmutex);
+					interval = m_interval;
+					m_interval = Stats();
+					m_interval.m_start = now;
+				}
+				PrintStats("last " + std::to_string(params.m_statsinterval) + " s", interval);
+				lastprint = now;
+			}
+		}
+
+		if (!m_stop)
+		{
+			// let the detector finish the last frames so they are counted
+			while (!m_stop && params.m_idle && !params.m_idle())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+
+		Stats total;
+		{
+			std::lock_guard<std::mutex> guard(m_statsmutex);
+			total = m_total;
+		}
+		PrintStats("total", total);
+
+		if (!m_stop && params.m_finished)
+		{
+			params.m_finished();
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "SyntheticCaptureThread::Run caught " << e.what() << std::endl;
+	}
+
+	std::cout << "SyntheticCaptureThread::Run Thread Complete" << std::endl;
+}
+
+void SyntheticCaptureThread::ReceivePose(const PoseDetection& posedetection)
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> guard(m_statsmutex);
+	if (posedetection.m_sequence <= m_lastdelivered)
+	{
+		return;
+	}
+	m_lastdelivered = posedetection.m_sequence;
+
+	const float ms = std::chrono::duration<float, std::milli>(now - posedetection.m_timestamp).count();
+
+	PoseDetection expected;
+	SyntheticPose(posedetection.m_sequence, m_width, m_height, m_cyclelength, expected);
+	double error = 0;
+	uint64_t keypoints = 0;
+	for (size_t i = 0; i < posedetection.m_keypoints.size(); i++)
+	{
+		if (posedetection.m_keypoints[i].m_presence == KEYPOINT_PRESENCE_PRESENT && expected.m_keypoints[i].m_presence == KEYPOINT_PRESENCE_PRESENT)
+		{
+			error += posedetection.m_keypoints[i].m_pos.Distance(expected.m_keypoints[i].m_pos);
+			keypoints++;
+		}
+	}
+
+	for (Stats* stats : { &m_interval, &m_total })
+	{
+		stats->m_delivered++;
+		stats->m_latencies.push_back(ms);
+		stats->m_keypointerror += error;
+		stats->m_keypoints += keypoints;
+	}
+}
+
+void SyntheticCaptureThread::SyntheticPose(const uint64_t sequence, const int32_t width, const int32_t height, const int32_t cyclelength, PoseDetection& posedetection)
+{
+	// a person facing the camera swaying side to side, bobbing up and down and swinging their arms, sized to the frame height
+	const double pi = 3.14159265358979323846;
+	const int32_t cycle = std::max(cyclelength, 1);
+	const float phase = static_cast<float>((2.0 * pi * static_cast<double>((sequence > 0 ? sequence - 1 : 0) % cycle)) / cycle);
+	const float h = static_cast<float>(height);
+	const float sway = std::sin(phase);
+	const float lean = 0.15f * sway;
+
+	posedetection = PoseDetection();
+	posedetection.m_id = 0;
+	posedetection.m_score = 1.0f;
+	posedetection.m_sequence = sequence;
+
+	auto set = [&posedetection](const KeypointLocation location, const float x, const float y)
+	{
+		KeypointDetection& keypoint = posedetection.m_keypoints[location];
+		keypoint.m_presence = KEYPOINT_PRESENCE_PRESENT;
+		keypoint.m_pos.m_x = x;
+		keypoint.m_pos.m_y = y;
+		keypoint.m_score = 1.0f;
+	};
+
+	// the person's right is on the left of the image, side is -1 for right and 1 for left
+	const float hipx = (static_cast<float>(width) * 0.5f) + (0.08f * h * sway);
+	const float hipy = (0.55f * h) + (0.02f * h * std::cos(2.0f * phase));
+	const float shoulderx = hipx + (0.28f * h * std::sin(lean));
+	const float shouldery = hipy - (0.28f * h * std::cos(lean));
+	const float nosex = shoulderx + (0.13f * h * std::sin(lean));
+	const float nosey = shouldery - (0.13f * h * std::cos(lean));
+
+	set(KEYPOINT_NOSE, nosex, nosey);
+	set(KEYPOINT_RIGHT_EYE_CENTER, nosex - (0.025f * h), nosey - (0.02f * h));
+	set(KEYPOINT_LEFT_EYE_CENTER, nosex + (0.025f * h), nosey - (0.02f * h));
+	set(KEYPOINT_RIGHT_EAR, nosex - (0.045f * h), nosey - (0.01f * h));
+	set(KEYPOINT_LEFT_EAR, nosex + (0.045f * h), nosey - (0.01f * h));
+	set(KEYPOINT_MOUTH_CENTER, nosex, nosey + (0.03f * h));
+
+	for (const float side : { -1.0f, 1.0f })
+	{
+		const bool left = side > 0;
+
+		// angles are from straight down, positive away from the body
+		const float upperarm = 0.4f + (0.5f * side * sway);
+		const float forearm = upperarm + 0.6f + (0.4f * std::cos(phase));
+		const float sx = shoulderx + (side * 0.09f * h);
+		const float ex = sx + (side * 0.14f * h * std::sin(upperarm));
+		const float ey = shouldery + (0.14f * h * std::cos(upperarm));
+		set(left ? KEYPOINT_LEFT_SHOULDER : KEYPOINT_RIGHT_SHOULDER, sx, shouldery);
+		set(left ? KEYPOINT_LEFT_ELBOW : KEYPOINT_RIGHT_ELBOW, ex, ey);
+		set(left ? KEYPOINT_LEFT_WRIST : KEYPOINT_RIGHT_WRIST, ex + (side * 0.12f * h * std::sin(forearm)), ey + (0.12f * h * std::cos(forearm)));
+
+		const float thigh = 0.12f + (0.08f * side * sway);
+		const float hx = hipx + (side * 0.06f * h);
+		const float kx = hx + (side * 0.19f * h * std::sin(thigh));
+		const float ky = hipy + (0.19f * h * std::cos(thigh));
+		set(left ? KEYPOINT_LEFT_HIP : KEYPOINT_RIGHT_HIP, hx, hipy);
+		set(left ? KEYPOINT_LEFT_KNEE : KEYPOINT_RIGHT_KNEE, kx, ky);
+		set(left ? KEYPOINT_LEFT_ANKLE : KEYPOINT_RIGHT_ANKLE, kx + (side * 0.19f * h * std::sin(0.05f)), ky + (0.19f * h * std::cos(0.05f)));
+	}
+}
+
+void SyntheticCaptureThread::DrawFrame(const PoseDetection& posedetection, cv::Mat& frame) const
+{
+	frame.create(m_height, m_width, CV_8UC3);
+	frame.setTo(cv::Scalar(110, 110, 110));
+
+	auto point = [&posedetection](const KeypointLocation location) { return cv::Point(static_cast<int>(posedetection.m_keypoints[location].m_pos.m_x), static_cast<int>(posedetection.m_keypoints[location].m_pos.m_y)); };
+	const int thickness = std::max(m_height / 30, 2);
+	const cv::Scalar skin(120, 160, 210);
+	const cv::Scalar shirt(150, 70, 40);
+	const cv::Scalar trousers(60, 50, 50);
+
+	const std::vector<cv::Point> torso{ point(KEYPOINT_RIGHT_SHOULDER), point(KEYPOINT_LEFT_SHOULDER), point(KEYPOINT_LEFT_HIP), point(KEYPOINT_RIGHT_HIP) };
+	cv::fillConvexPoly(frame, torso, shirt, cv::LINE_AA);
+	cv::line(frame, point(KEYPOINT_RIGHT_SHOULDER), point(KEYPOINT_LEFT_SHOULDER), shirt, thickness, cv::LINE_AA);
+	cv::line(frame, point(KEYPOINT_RIGHT_HIP), point(KEYPOINT_LEFT_HIP), trousers, thickness, cv::LINE_AA);
+
+	const std::array<std::array<KeypointLocation, 3>, 4> limbs{ {
+		{ KEYPOINT_RIGHT_SHOULDER, KEYPOINT_RIGHT_ELBOW, KEYPOINT_RIGHT_WRIST },
+		{ KEYPOINT_LEFT_SHOULDER, KEYPOINT_LEFT_ELBOW, KEYPOINT_LEFT_WRIST },
+		{ KEYPOINT_RIGHT_HIP, KEYPOINT_RIGHT_KNEE, KEYPOINT_RIGHT_ANKLE },
+		{ KEYPOINT_LEFT_HIP, KEYPOINT_LEFT_KNEE, KEYPOINT_LEFT_ANKLE } } };
+	for (size_t i = 0; i < limbs.size(); i++)
+	{
+		const cv::Scalar& colour = (i < 2) ? skin : trousers;
+		cv::line(frame, point(limbs[i][0]), point(limbs[i][1]), colour, thickness, cv::LINE_AA);
+		cv::line(frame, point(limbs[i][1]), point(limbs[i][2]), colour, thickness, cv::LINE_AA);
+	}
+
+	// neck and head, with the eyes and mouth on top
+	const cv::Point neck((point(KEYPOINT_RIGHT_SHOULDER) + point(KEYPOINT_LEFT_SHOULDER)) / 2);
+	cv::line(frame, neck, point(KEYPOINT_MOUTH_CENTER), skin, thickness, cv::LINE_AA);
+	cv::circle(frame, point(KEYPOINT_NOSE), static_cast<int>(0.065f * static_cast<float>(m_height)), skin, cv::FILLED, cv::LINE_AA);
+	cv::circle(frame, point(KEYPOINT_RIGHT_EYE_CENTER), std::max(m_height / 160, 1), cv::Scalar(40, 40, 40), cv::FILLED, cv::LINE_AA);
+	cv::circle(frame, point(KEYPOINT_LEFT_EYE_CENTER), std::max(m_height / 160, 1), cv::Scalar(40, 40, 40), cv::FILLED, cv::LINE_AA);
+	cv::line(frame, point(KEYPOINT_MOUTH_CENTER) - cv::Point(m_height / 80, 0), point(KEYPOINT_MOUTH_CENTER) + cv::Point(m_height / 80, 0), cv::Scalar(60, 60, 140), std::max(m_height / 240, 1), cv::LINE_AA);
+}
+
+bool SyntheticCaptureThread::WaitUntil(const std::chrono::steady_clock::time_point time)
+{
+	while (!m_stop)
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now >= time)
+		{
+			return true;
+		}
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(time - now, std::chrono::milliseconds(10)));
+	}
+	return false;
+}
+
+void SyntheticCaptureThread::PrintStats(const std::string& label, Stats stats) const
+{
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stats.m_start).count();
+	const uint64_t frames = stats.m_sent + stats.m_unsent;
+	const double dropped = (frames > stats.m_delivered) ? (100.0 * static_cast<double>(frames - stats.m_delivered)) / static_cast<double>(frames) : 0.0;
+
+	std::sort(stats.m_latencies.begin(), stats.m_latencies.end());
+	auto percentile = [&stats](const double p) -> float
+	{
+		return stats.m_latencies.empty() ? 0.0f : stats.m_latencies[std::min(stats.m_latencies.size() - 1, static_cast<size_t>((p * static_cast<double>(stats.m_latencies.size() - 1)) + 0.5))];
+	};
+
+	std::cout << "Synthetic " << label << ": " << frames << " frames generated (" << ((seconds > 0) ? static_cast<double>(frames) / seconds : 0.0) << " fps), ";
+	std::cout << stats.m_delivered << " delivered (" << ((seconds > 0) ? static_cast<double>(stats.m_delivered) / seconds : 0.0) << " fps), ";
+	std::cout << dropped << "% dropped (" << stats.m_unsent << " with no free buffer), ";
+	std::cout << "latency p50 " << percentile(0.5) << " p95 " << percentile(0.95) << " max " << percentile(1.0) << " ms, ";
+	std::cout << "keypoint error " << ((stats.m_keypoints > 0) ? stats.m_keypointerror / static_cast<double>(stats.m_keypoints) : 0.0) << " px" << std::endl;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ithread.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "framepool.h"
+#include "posekeypointdata.h"
+
+#include <opencv2/core/mat.hpp>
+
+/*
+
+	Frame source drawing a moving stick figure instead of reading a camera, for benchmarking the pipeline without any hardware
+	Every frame's keypoints are known, so detections can be scored as well as timed
+	Frame n is timestamped exactly n / m_fps after the start and sent at that time
+
+	Wire ReceivePose to the detector's detections to collect throughput, drop rate, capture to delivery latency and keypoint error
+
+*/
+
+class SyntheticCaptureThread :public IThread
+{
+public:
+	SyntheticCaptureThread();
+	virtual ~SyntheticCaptureThread();
+
+	struct SyntheticCaptureThreadParameters :public IThread::ThreadParameters
+	{
+		std::function<void(const int32_t)> m_sendframe;		// receives ownership of a m_framepool slot
+		std::function<bool()> m_framepending = nullptr;		// true while the last frame sent hasn't been taken yet, when m_fps is 0 FrameTaken is waited for until it's false
+		std::function<bool()> m_ready = nullptr;			// true once the detector can take frames, nothing is generated before then
+		std::function<bool()> m_idle = nullptr;				// true once everything sent has been processed, checked before m_finished
+		std::function<void()> m_finished = nullptr;			// called after m_frames frames
+		FramePool* m_framepool{ nullptr };
+		int32_t m_width{ 640 };
+		int32_t m_height{ 480 };
+		double m_fps{ 30 };									// 0 sends each frame as soon as the detector has taken the last one, waiting for a free frame pool slot if needed
+		int32_t m_cliplength{ 60 };							// frames in one movement cycle, drawn up front and looped, 0 draws every frame as it's sent with a 60 frame cycle
+		uint64_t m_frames{ 0 };								// frames to send before finishing, 0 to run until stopped
+		int32_t m_statsinterval{ 5 };						// seconds between stats printouts, 0 to only print them at the end
+	};
+
+	void ReceivePose(const PoseDetection& posedetection);
+	void FrameTaken();		// wire to the detector's m_frametaken
+
+	void Stop();
+
+	// where the figure's keypoints are on frame number sequence, in pixels
+	static void SyntheticPose(const uint64_t sequence, const int32_t width, const int32_t height, const int32_t cyclelength, PoseDetection& posedetection);
+
+private:
+
+	// counters for a stats period
+	struct Stats
+	{
+		uint64_t m_sent{ 0 };
+		uint64_t m_unsent{ 0 };			// no free frame pool slot
+		uint64_t m_delivered{ 0 };
+		std::vector<float> m_latencies;	// ms from capture timestamp to delivery
+		double m_keypointerror{ 0 };	// sum of pixel distances from the drawn keypoints
+		uint64_t m_keypoints{ 0 };
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	void Run(const IThread::ThreadParameters* threadparameters);
+
+	void DrawFrame(const PoseDetection& posedetection, cv::Mat& frame) const;
+	bool WaitUntil(const std::chrono::steady_clock::time_point time);		// false if stopped while waiting
+	void PrintStats(const std::string& label, Stats stats) const;
+
+	std::function<void(const int32_t)> m_sendframe;
+	FramePool* m_framepool;
+	std::mutex m_takenmutex;
+	std::condition_variable m_takencv;	// signalled when the detector takes a frame or the thread is stopped
+
+	int32_t m_width;
+	int32_t m_height;
+	int32_t m_cyclelength;
+	uint64_t m_lastdelivered;		// highest sequence delivered, repeats from keypoint tracking aren't counted twice
+	std::mutex m_statsmutex;
+	Stats m_interval;				// since the last printout
+	Stats m_total;
+
+};
@@ -40,8 +40,8 @@ void TCodeGenerator::Run(const ThreadParameters* threadparameters)
 	timeBeginPeriod(1);
 #endif
 
-	std::chrono::high_resolution_clock::time_point lasttime = std::chrono::high_resolution_clock::now();
-	std::chrono::high_resolution_clock::time_point thistime = lasttime;
+	std::chrono::steady_clock::time_point lasttime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point thistime = lasttime;
 
 	// debug
 	m_circlerad = 0;
@@ -50,7 +50,7 @@ void TCodeGenerator::Run(const ThreadParameters* threadparameters)
 
 	while (!m_stop)
 	{
-		thistime = std::chrono::high_resolution_clock::now();
+		thistime = std::chrono::steady_clock::now();
 		if (std::chrono::duration_cast<std::chrono::milliseconds>(thistime - lasttime).count() >= 10)
 		{
 			// generate and send TCode
@@ -82,7 +82,8 @@ void TCodeGenerator::Run(const ThreadParameters* threadparameters)
 void TCodeGenerator::ReceivePose(const PoseDetection& pose)
 {
 	//std::cout << "TCodeGenerator::ReceivePose " << std::endl;
-	const std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+	// windows are measured in capture time so a file read faster than real time covers the same stretch of video
+	const std::chrono::steady_clock::time_point now = pose.m_timestamp;
 
 	std::lock_guard<std::mutex> guard(m_posemutex);
 	m_keypoints.push_back(pose);
@@ -90,6 +91,7 @@ void TCodeGenerator::ReceivePose(const PoseDetection& pose)
 	// calculate the average pose locations
 	PoseDetection pd;
 	pd.m_timestamp = pose.m_timestamp;
+	pd.m_sequence = pose.m_sequence;
 	int32_t cnt = 0;
 	std::array<std::list<KeypointDetection>, KeypointLocation::KEYPOINT_MAX> tempkeypoints;
 	
@@ -117,6 +119,7 @@ void TCodeGenerator::ReceivePose(const PoseDetection& pose)
 	// calculate pose movement (30 seconds of data for center/min/max locations)
 	PoseMovement pm;
 	ConsolidateKeypointsToPoses(m_avgkeypoints, pose.m_timestamp, pm);
+	pm.m_sequence = pose.m_sequence;
 	m_posemovement.push_back(pm);
 
 	if (m_sendposemovement)
@@ -144,13 +147,13 @@ void TCodeGenerator::SetPoseTrackingLocation(const PoseTrackingLocation location
 	m_posetrackinglocation = location;
 }
 
-void TCodeGenerator::ConsolidateKeypointsToPoses(const std::list<PoseDetection>& keypoints, const std::chrono::high_resolution_clock::time_point& timestamp, PoseMovement& pm)
+void TCodeGenerator::ConsolidateKeypointsToPoses(const std::list<PoseDetection>& keypoints, const std::chrono::steady_clock::time_point& timestamp, PoseMovement& pm)
 {
 	pm.m_timestamp = timestamp;
-	std::array<std::pair<std::vector<KeypointDetection>,std::vector<std::chrono::high_resolution_clock::time_point>>, PoseTrackingLocation::POSE_TRACKING_MAX> m_posekeypoints;
+	std::array<std::pair<std::vector<KeypointDetection>,std::vector<std::chrono::steady_clock::time_point>>, PoseTrackingLocation::POSE_TRACKING_MAX> m_posekeypoints;
 	for (size_t i = 0; i < pm.m_posetracking.size(); i++)
 	{
-		for (std::list<PoseDetection>::const_reverse_iterator j = keypoints.rbegin(); j != keypoints.rend() && (*j).m_timestamp > (std::chrono::high_resolution_clock::now() - std::chrono::seconds(30)); j++)
+		for (std::list<PoseDetection>::const_reverse_iterator j = keypoints.rbegin(); j != keypoints.rend() && (*j).m_timestamp > (timestamp - std::chrono::seconds(30)); j++)
 		{
 			int64_t count = 0;
 			KeypointDetection avg;
@@ -255,7 +258,7 @@ void TCodeGenerator::ConsolidateKeypointsToPoses(const std::list<PoseDetection>&
 	}
 }
 
-void TCodeGenerator::UpdateRestimCirclePosition(const std::chrono::high_resolution_clock::time_point& lasttimestamp, const std::chrono::high_resolution_clock::time_point& timestamp)
+void TCodeGenerator::UpdateRestimCirclePosition(const std::chrono::steady_clock::time_point& lasttimestamp, const std::chrono::steady_clock::time_point& timestamp)
 {
 	std::ostringstream ostr;
 	// TODO - generate position
@@ -293,7 +296,7 @@ void TCodeGenerator::UpdateRestimCirclePosition(const std::chrono::high_resoluti
 	}
 }
 
-void TCodeGenerator::UpdateRestimPosePosition(const std::chrono::high_resolution_clock::time_point& lasttimestamp, const std::chrono::high_resolution_clock::time_point& timestamp)
+void TCodeGenerator::UpdateRestimPosePosition(const std::chrono::steady_clock::time_point& lasttimestamp, const std::chrono::steady_clock::time_point& timestamp)
 {
 	//std::cout << "TCodeGenerator::UpdateRestimPosePosition" << std::endl;
 	std::ostringstream ostr;
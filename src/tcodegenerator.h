@@ -72,7 +72,7 @@ private:
 	std::list<PoseDetection> m_avgkeypoints;
 
 	bool m_poselowvolume;
-	std::chrono::high_resolution_clock::time_point m_poselastupdate;
+	std::chrono::steady_clock::time_point m_poselastupdate;
 
 	// debug
 	float m_circlerad;
@@ -80,8 +80,8 @@ private:
 	std::list<PoseMovement> m_posemovement;
 	std::map<PoseTrackingLocation, std::vector<KeypointLocation>> m_posekeypointmapping;
 
-	void ConsolidateKeypointsToPoses(const std::list<PoseDetection>& keypoints, const std::chrono::high_resolution_clock::time_point &timestamp, PoseMovement& pm);
+	void ConsolidateKeypointsToPoses(const std::list<PoseDetection>& keypoints, const std::chrono::steady_clock::time_point &timestamp, PoseMovement& pm);
 
-	void UpdateRestimCirclePosition(const std::chrono::high_resolution_clock::time_point &lasttimestamp, const std::chrono::high_resolution_clock::time_point &timestamp);
-	void UpdateRestimPosePosition(const std::chrono::high_resolution_clock::time_point& lasttimestamp, const std::chrono::high_resolution_clock::time_point& timestamp);
+	void UpdateRestimCirclePosition(const std::chrono::steady_clock::time_point &lasttimestamp, const std::chrono::steady_clock::time_point &timestamp);
+	void UpdateRestimPosePosition(const std::chrono::steady_clock::time_point& lasttimestamp, const std::chrono::steady_clock::time_point& timestamp);
 };
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Statically quantize a float pose model to INT8 for restimulator.
+
+Calibration frames are read from a directory of images or captured from a camera, and are
+preprocessed the same way restimulator does it: a centered square crop, resized to the model
+input size, converted to RGB and normalized with (pixel / div) + add.
+
+The output is a QDQ model with per-channel INT8 weights and UINT8 activations.  The input keeps
+its type, so it can be passed to --posemodel or --posemodelfast unchanged.  Float, int32 (the
+usual tf2onnx MoveNet export) and uint8 inputs can be calibrated.
+
+e.g. quantize_movenet.py movenet_thunder.onnx movenet_thunder_int8.onnx --images calibration/
+     quantize_movenet.py movenet_lightning.onnx movenet_lightning_int8.onnx --camera 0 --count 200
+"""
+
+import argparse
+import os
+import sys
+
+import cv2
+import numpy as np
+import onnx
+from onnxruntime.quantization import CalibrationDataReader, CalibrationMethod, QuantFormat, QuantType, quantize_static
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+
+# numpy type of each input type that can be calibrated
+INPUT_TYPES = {
+    onnx.TensorProto.FLOAT: np.float32,
+    onnx.TensorProto.INT32: np.int32,
+    onnx.TensorProto.UINT8: np.uint8,
+}
+
+
+def preprocess(frame, size, div, add, dtype):
+    height, width = frame.shape[:2]
+    cropsize = min(width, height)
+    x = (width - cropsize) // 2
+    y = (height - cropsize) // 2
+    crop = frame[y:y + cropsize, x:x + cropsize]
+    crop = cv2.resize(crop, (size, size), interpolation=cv2.INTER_LINEAR)
+    crop = cv2.cvtColor(crop, cv2.COLOR_BGR2RGB).astype(np.float32)
+    tensor = crop / div + add
+    if dtype != np.float32:
+        # integer inputs are clamped to 0 - 255 and truncated, as restimulator's lut does
+        tensor = np.clip(tensor, 0.0, 255.0)
+    return np.expand_dims(tensor.astype(dtype), 0)
+
+
+def image_frames(directory, count):
+    extensions = (".jpg", ".jpeg", ".png", ".bmp")
+    names = sorted(name for name in os.listdir(directory) if name.lower().endswith(extensions))
+    for name in names[:count]:
+        frame = cv2.imread(os.path.join(directory, name))
+        if frame is not None:
+            yield frame
+
+
+def camera_frames(index, count):
+    capture = cv2.VideoCapture(index)
+    if not capture.isOpened():
+        raise RuntimeError("Couldn't open camera " + str(index))
+    try:
+        for _ in range(count):
+            ok, frame = capture.read()
+            if not ok:
+                break
+            yield frame
+    finally:
+        capture.release()
+
+
+class PoseCalibrationReader(CalibrationDataReader):
+    def __init__(self, inputname, frames, size, div, add, dtype):
+        self.inputname = inputname
+        self.tensors = [preprocess(frame, size, div, add, dtype) for frame in frames]
+        self.iterator = iter(self.tensors)
+        print("Collected", len(self.tensors), "calibration frames")
+
+    def get_next(self):
+        tensor = next(self.iterator, None)
+        return None if tensor is None else {self.inputname: tensor}
+
+    def rewind(self):
+        self.iterator = iter(self.tensors)
+
+
+def model_input(path):
+    model = onnx.load(path)
+    modelinput = model.graph.input[0]
+    elemtype = modelinput.type.tensor_type.elem_type
+    if elemtype not in INPUT_TYPES:
+        raise RuntimeError("Model input " + modelinput.name + " is " + onnx.TensorProto.DataType.Name(elemtype) +
+                           ", only float, int32 and uint8 inputs can be calibrated")
+    dims = modelinput.type.tensor_type.shape.dim
+    size = dims[1].dim_value if len(dims) == 4 and dims[1].dim_value > 0 else 0
+    return modelinput.name, size, INPUT_TYPES[elemtype]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Statically quantize a pose model to INT8")
+    parser.add_argument("model", help="float ONNX model")
+    parser.add_argument("output", help="quantized ONNX model")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--images", help="directory of calibration images")
+    source.add_argument("--camera", type=int, help="camera index to capture calibration frames from")
+    parser.add_argument("--count", type=int, default=100, help="number of calibration frames")
+    parser.add_argument("--size", type=int, default=0, help="input size for models with a dynamic input size")
+    parser.add_argument("--div", type=float, default=1.0, help="pixel divisor, as --posediv")
+    parser.add_argument("--add", type=float, default=0.0, help="value added after dividing, as --poseadd")
+    parser.add_argument("--per-tensor", action="store_true", help="quantize weights per tensor instead of per channel")
+    args = parser.parse_args()
+
+    inputname, size, dtype = model_input(args.model)
+    size = args.size if args.size > 0 else size
+    if size <= 0:
+        print("Model has a dynamic input size, set it with --size", file=sys.stderr)
+        return 1
+
+    frames = image_frames(args.images, args.count) if args.images else camera_frames(args.camera, args.count)
+    reader = PoseCalibrationReader(inputname, frames, size, args.div, args.add, dtype)
+    if not reader.tensors:
+        print("No calibration frames", file=sys.stderr)
+        return 1
+
+    preprocessed = args.output + ".pre.onnx"
+    quant_pre_process(args.model, preprocessed)
+    try:
+        quantize_static(preprocessed, args.output, reader,
+                        quant_format=QuantFormat.QDQ,
+                        per_channel=not args.per_tensor,
+                        activation_type=QuantType.QUInt8,
+                        weight_type=QuantType.QInt8,
+                        calibrate_method=CalibrationMethod.MinMax)
+    finally:
+        os.remove(preprocessed)
+
+    print("Wrote", args.output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())